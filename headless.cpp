@@ -0,0 +1,262 @@
+// Runs the game simulation without a window or a GPU, for regression runs
+// and tuning sweeps: collision data is read from scene.json and the models
+// it lists, inputs from a script or a recording of the game
+// (CG-Project --record FILE)
+
+#include "modules/Assets.hpp"
+#include "modules/Scene.hpp"
+#include "modules/Simulation.hpp"
+#include "modules/RocketBatch.hpp"
+
+#include <iomanip>
+
+/// Collisions only need the positions
+struct Vertex {
+	glm::vec3 pos;
+};
+
+/**
+ * Models and instances of a scene file, decoded on the CPU only
+ */
+class HeadlessScene {
+public:
+	struct Instance {
+		std::string id;
+		std::string model;
+		glm::mat4 Wm;
+	};
+	std::vector<Instance> instances;
+
+	HeadlessScene() {
+		VF.Position = {true, offsetof(Vertex, pos)};
+		VF.Normal = VF.UV = VF.Color = VF.Tangent = {false, 0};
+		VF.stride = sizeof(Vertex);
+		VF.hash = VF.hashLayout();
+	}
+
+	/**
+	 * Start decoding a model, shared by every instance of the file
+	 */
+	const Mesh<Vertex> &model(const std::string &file, ModelType MT) {
+		std::unique_ptr<Mesh<Vertex>> &m = meshes[file];
+		if(!m) {
+			m.reset(new Mesh<Vertex>());
+			m->loadAsync(&VF, file, MT);
+			pending.push_back(m.get());
+		}
+		return *m;
+	}
+
+	/**
+	 * Read the models and the world matrices of the instances, as the
+	 * game does
+	 */
+	void load(const std::string &file) {
+		SceneDescription sd = SceneInterpreter::parse(file);
+		for(auto &md : sd.models) {
+			model(md.file, md.format);
+			modelFiles[md.id] = md.file;
+		}
+
+		TransformHierarchy transforms;
+		for(auto &id : sd.instances) {
+			glm::mat4 Wm = transforms.world(transforms.add(id.parent, id.Wm));
+			instances.push_back({sd.name(id.id), sd.models[id.model].id, Wm});
+		}
+	}
+
+	/// Mesh of a model id of the scene
+	const Mesh<Vertex> &mesh(const std::string &modelId) {
+		auto it = modelFiles.find(modelId);
+		if(it == modelFiles.end()) throw std::runtime_error("unknown model: " + modelId);
+		return *meshes[it->second];
+	}
+
+	/// Wait for every model started
+	void wait() {
+		for(Mesh<Vertex> *m : pending) m->wait();
+		pending.clear();
+	}
+
+private:
+	VertexFormat VF{};
+	std::unordered_map<std::string, std::unique_ptr<Mesh<Vertex>>> meshes;
+	std::unordered_map<std::string, std::string> modelFiles;
+	std::vector<Mesh<Vertex> *> pending;
+
+};
+
+void usage() {
+	std::cout << "Usage: CG-Headless [--scene FILE] [--inputs FILE] [--ticks N]\n"
+			  << "                   [--seed N] [--boxes] [--trace]\n"
+			  << "                   [--batch N [--check]]\n"
+			  << "  --inputs  input script or recording, nothing held if missing\n"
+			  << "  --ticks   ticks to run (length of the inputs, or 1000)\n"
+			  << "  --boxes   collide with the boxes only, not the triangles\n"
+			  << "  --trace   print the rocket after every tick\n"
+			  << "  --batch   fly N rockets on the boxes at once, their thrust going\n"
+			  << "            from half to twice the game's\n"
+			  << "  --check   compare the rockets of the batch with Simulation\n";
+}
+
+/// Largest distance --check allows between a batch rocket and Simulation
+const float BATCH_TOLERANCE = 1e-4f;
+
+/**
+ * Fly a batch of rockets from where sim starts, printing where they end
+ * @param check also fly each rocket alone and report the largest gap
+ * @return false if check finds a rocket further than BATCH_TOLERANCE
+ */
+bool runBatch(const Simulation &sim, const InputScript &script, long ticks,
+			  size_t count, bool check) {
+	std::vector<RocketParams> params(count);
+	for(size_t i = 0; i < count; i++) {
+		float spread = count > 1 ? (float)i / (float)(count - 1) : 0.0f;
+		params[i].moveSpeed *= 0.5f + 1.5f * spread;
+	}
+
+	RocketBatch batch;
+	batch.init(sim, params, count);
+	auto start = std::chrono::steady_clock::now();
+	for(long t = 0; t < ticks; t++) batch.step(script.at(t));
+	float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() -
+												 start).count();
+
+	for(size_t i = 0; i < count; i++) {
+		glm::vec3 p = batch.rocketPosition(i);
+		std::cout << i << " thrust " << params[i].moveSpeed << " " << p.x << " " << p.y
+				  << " " << p.z
+				  << (batch.rocketState(i) == RESTING ? " RESTING" : " MOVING") << "\n";
+	}
+	float steps = (float)ticks * (float)count;
+	std::cout << "Rockets: " << count << " x " << ticks << " ticks in "
+			  << elapsed * 1000.0f << " ms ("
+			  << (elapsed > 0.0f ? steps / elapsed : 0.0f) << " rocket ticks/s, "
+			  << ROCKET_LANES << " lanes)\n";
+	if(!check) return true;
+
+	float gap = 0.0f;
+	size_t worst = 0;
+	for(size_t i = 0; i < count; i++) {
+		std::unordered_map<std::string, BoundingBox> bbMap = sim.bbMap;
+		Simulation alone(bbMap);
+		alone.meshCollision = false;
+		alone.params = params[i];
+		alone.coinBounds = sim.coinBounds;
+		alone.coinCrownBounds = sim.coinCrownBounds;
+		alone.coinThunderBounds = sim.coinThunderBounds;
+		for(long t = 0; t < ticks; t++) alone.tick(script.at(t));
+		float d = glm::length(alone.rocketPosition - batch.rocketPosition(i));
+		if(d > gap) {
+			gap = d;
+			worst = i;
+		}
+	}
+	std::cout << "Largest gap from Simulation: " << gap << " (rocket " << worst << ")\n";
+	if(gap > BATCH_TOLERANCE) {
+		std::cout << "FAILED: the batch is more than " << BATCH_TOLERANCE
+				  << " away from Simulation\n";
+		return false;
+	}
+	return true;
+}
+
+void printRocket(const Simulation &sim) {
+	std::cout << sim.rocketPosition.x << " " << sim.rocketPosition.y << " "
+			  << sim.rocketPosition.z
+			  << (sim.rocketState == RESTING ? " RESTING" : " MOVING")
+			  << " coins " << sim.coinsCollected << "\n";
+}
+
+int main(int argc, char **argv) {
+	std::string sceneFile = "models/scene.json";
+	std::string inputFile;
+	long ticks = -1;
+	long seed = -1;
+	bool boxes = false;
+	bool trace = false;
+	long batch = 0;
+	bool check = false;
+
+	for(int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if(arg == "--scene" && hasValue) {
+			sceneFile = argv[++i];
+		} else if(arg == "--inputs" && hasValue) {
+			inputFile = argv[++i];
+		} else if(arg == "--ticks" && hasValue) {
+			ticks = std::atol(argv[++i]);
+		} else if(arg == "--seed" && hasValue) {
+			seed = std::atol(argv[++i]);
+		} else if(arg == "--boxes") {
+			boxes = true;
+		} else if(arg == "--trace") {
+			trace = true;
+		} else if(arg == "--batch" && hasValue) {
+			batch = std::atol(argv[++i]);
+		} else if(arg == "--check") {
+			check = true;
+		} else {
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	try {
+		InputScript script;
+		if(!inputFile.empty()) script.load(inputFile);
+		if(ticks < 0) ticks = inputFile.empty() ? 1000 : (long)script.size();
+
+		// Same coins as the game
+		HeadlessScene scene;
+		scene.load(sceneFile);
+		const Mesh<Vertex> &coin = scene.model("models/Coin_Gold.mgcg", MGCG);
+		const Mesh<Vertex> &coinCrown = scene.model("models/Coin_Crown_Gold.mgcg", MGCG);
+		const Mesh<Vertex> &coinThunder =
+			scene.model("models/Coin_Thunder_Gold.mgcg", MGCG);
+		scene.wait();
+
+		std::unordered_map<std::string, BoundingBox> bbMap;
+		Simulation sim(bbMap);
+		if(seed >= 0) sim.rng.seed(seed);
+		sim.meshCollision = !boxes;
+		sim.coinBounds = coin.bounds;
+		sim.coinCrownBounds = coinCrown.bounds;
+		sim.coinThunderBounds = coinThunder.bounds;
+
+		// The scene does not move, its boxes are placed once
+		for(auto &instance : scene.instances) {
+			const Mesh<Vertex> &mesh = scene.mesh(instance.model);
+			sim.placeObject(instance.model, mesh.bounds, &mesh.collisionMesh,
+							instance.id, instance.Wm);
+		}
+
+		std::cout << std::setprecision(9);
+		if(batch > 0) {
+			bool ok = runBatch(sim, script, ticks, batch, check);
+			return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		for(long t = 0; t < ticks; t++) {
+			sim.tick(script.at(t));
+			if(trace) {
+				std::cout << t << " ";
+				printRocket(sim);
+			}
+		}
+		float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() -
+													 start).count();
+
+		std::cout << "Ticks: " << ticks << " in " << elapsed * 1000.0f << " ms ("
+				  << (elapsed > 0.0f ? ticks / elapsed : 0.0f) << " ticks/s)\n"
+				  << "Rocket: ";
+		printRocket(sim);
+	} catch(const std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
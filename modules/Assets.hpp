@@ -0,0 +1,1357 @@
+// Decoding of models and scene transforms on the CPU, shared by the game
+// and the headless simulation: nothing in here needs Vulkan or a window
+
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <vector>
+#include <cstring>
+#include <optional>
+#include <set>
+#include <cstdint>
+#include <algorithm>
+#include <fstream>
+#include <array>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <queue>
+#include <memory>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define STARTER_AES_X86
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define STARTER_AES_TARGET
+#else
+#include <cpuid.h>
+#define STARTER_AES_TARGET __attribute__((target("aes,sse2")))
+#endif
+#elif defined(__aarch64__)
+#define STARTER_AES_ARM
+#include <arm_neon.h>
+#ifdef _MSC_VER
+#define STARTER_AES_TARGET
+#else
+// Built for any AArch64 CPU, the crypto extension is checked at runtime
+#define STARTER_AES_TARGET __attribute__((target("+crypto")))
+#endif
+#ifdef __linux__
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <chrono>
+
+#include "Collision.hpp"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define TINYGLTF_NOEXCEPTION
+#define JSON_NOEXCEPTION
+#define TINYGLTF_NO_INCLUDE_STB_IMAGE
+#include <tiny_gltf.h>
+
+#include <json.hpp>
+
+#include <plusaes.hpp>
+
+#define SINFL_IMPLEMENTATION
+#include <sinfl.h>
+
+
+std::vector<char> readFile(const std::string &filename) {
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	if(!file.is_open()) {
+		std::cout << "Failed to open: " << filename << "\n";
+		throw std::runtime_error("failed to open file!");
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> buffer(fileSize);
+	// std::cout << filename << " -> " << fileSize << " B\n";
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+
+	file.close();
+
+	return buffer;
+}
+
+/**
+ * Read-only view of a whole file, memory mapped where the platform
+ * allows it (plain read otherwise)
+ */
+struct MappedFile {
+	const char *data = nullptr;
+	size_t size = 0;
+
+	MappedFile() = default;
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	bool open(const std::string &filename) {
+		close();
+#ifndef _WIN32
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if(fd < 0) return false;
+
+		struct stat st;
+		if(fstat(fd, &st) != 0 || st.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+
+		void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if(ptr == MAP_FAILED) return false;
+
+		data = static_cast<const char *>(ptr);
+		size = st.st_size;
+#else
+		std::ifstream file(filename, std::ios::ate | std::ios::binary);
+		if(!file.is_open()) return false;
+
+		fallback.resize((size_t)file.tellg());
+		file.seekg(0);
+		file.read(fallback.data(), fallback.size());
+
+		data = fallback.data();
+		size = fallback.size();
+#endif
+		return true;
+	}
+
+	void close() {
+#ifndef _WIN32
+		if(data != nullptr) munmap((void *)data, size);
+#else
+		fallback.clear();
+		fallback.shrink_to_fit();
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	~MappedFile() { close(); }
+
+private:
+#ifdef _WIN32
+	std::vector<char> fallback;
+#endif
+};
+
+/**
+ * Reports files modified on disk, without blocking: meant to be
+ * polled once per frame. On Linux it uses inotify on the parent
+ * directories, so that files replaced through a rename are seen too;
+ * elsewhere it compares modification times.
+ */
+class FileWatcher {
+public:
+	FileWatcher() = default;
+	FileWatcher(const FileWatcher &) = delete;
+	FileWatcher &operator=(const FileWatcher &) = delete;
+
+	/// Name poll() reports file with
+	static std::string key(const std::string &file) {
+		return std::filesystem::path(file).lexically_normal().generic_string();
+	}
+
+	void watch(const std::string &file) {
+		std::filesystem::path path = std::filesystem::path(file).lexically_normal();
+		std::string key = path.generic_string();
+		if(files.find(key) != files.end()) return;
+
+		std::error_code ec;
+		files[key] = std::filesystem::last_write_time(path, ec);
+
+#ifdef __linux__
+		if(fd < 0) fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if(fd < 0) return;
+
+		std::string dir = path.has_parent_path() ? path.parent_path().generic_string() : ".";
+		int wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if(wd < 0) {
+			std::cout << "Warning: cannot watch " << dir << "\n";
+		} else {
+			dirs[wd] = path.has_parent_path() ? dir + "/" : "";
+		}
+#endif
+	}
+
+	/// Watched files changed since the last call, each reported once
+	std::vector<std::string> poll() {
+		std::vector<std::string> changed;
+#ifdef __linux__
+		if(fd >= 0) {
+			alignas(struct inotify_event) char buffer[4096];
+			ssize_t len;
+			while((len = read(fd, buffer, sizeof(buffer))) > 0) {
+				for(char *ptr = buffer; ptr < buffer + len;) {
+					auto *event = reinterpret_cast<struct inotify_event *>(ptr);
+					ptr += sizeof(struct inotify_event) + event->len;
+
+					auto dir = dirs.find(event->wd);
+					if(dir == dirs.end() || event->len == 0) continue;
+					std::string key = dir->second + event->name;
+					if(files.find(key) != files.end() &&
+					   std::find(changed.begin(), changed.end(), key) == changed.end()) {
+						changed.push_back(key);
+					}
+				}
+			}
+			return changed;
+		}
+#endif
+		for(auto &file : files) {
+			std::error_code ec;
+			auto time = std::filesystem::last_write_time(file.first, ec);
+			if(!ec && time != file.second) {
+				file.second = time;
+				changed.push_back(file.first);
+			}
+		}
+		return changed;
+	}
+
+	~FileWatcher() {
+#ifdef __linux__
+		if(fd >= 0) ::close(fd);
+#endif
+	}
+
+private:
+	/// Watched files and their modification time when last seen
+	std::unordered_map<std::string, std::filesystem::file_time_type> files;
+#ifdef __linux__
+	int fd = -1;
+	/// Watch descriptor -> watched directory prefix
+	std::unordered_map<int, std::string> dirs;
+#endif
+};
+
+/**
+ * Fixed set of worker threads used for CPU-side asset decoding
+ * (file reads, decryption, inflating, parsing, image decoding).
+ * Vulkan objects are never touched from the workers.
+ */
+class ThreadPool {
+public:
+	explicit ThreadPool(unsigned int count) {
+		for(unsigned int i = 0; i < count; i++) {
+			workers.emplace_back([this]() { work(); });
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			stopping = true;
+		}
+		wakeUp.notify_all();
+		for(auto &w : workers) w.join();
+	}
+
+	/**
+	 * Queue a job; exceptions thrown by the job are rethrown by get()
+	 */
+	std::future<void> submit(std::function<void()> job) {
+		auto task = std::make_shared<std::packaged_task<void()>>(std::move(job));
+		std::future<void> result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			jobs.push([task]() { (*task)(); });
+		}
+		wakeUp.notify_one();
+		return result;
+	}
+
+	/**
+	 * Block until every queued job has completed
+	 */
+	void waitIdle() {
+		std::unique_lock<std::mutex> lock(mtx);
+		idle.wait(lock, [this]() { return jobs.empty() && running == 0; });
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex mtx;
+	std::condition_variable wakeUp;
+	std::condition_variable idle;
+	int running = 0;
+	bool stopping = false;
+
+	void work() {
+		while(true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mtx);
+				wakeUp.wait(lock, [this]() { return stopping || !jobs.empty(); });
+				if(jobs.empty()) return;
+
+				job = std::move(jobs.front());
+				jobs.pop();
+				running++;
+			}
+
+			job();
+
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				running--;
+				if(jobs.empty() && running == 0) idle.notify_all();
+			}
+		}
+	}
+};
+
+/**
+ * Pool shared by every asset loader, one worker per core
+ */
+ThreadPool &loaderPool() {
+	static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	return pool;
+}
+
+/**
+ * AES-CBC decryption of whole blocks. Uses AES-NI or the ARMv8 crypto
+ * extension when the CPU supports them (eight independent blocks are kept
+ * in flight to hide the instruction latency), plusaes otherwise.
+ * Padding is left to the caller; input and output may overlap exactly.
+ */
+class AesCbcDecryptor {
+public:
+	enum Backend { PORTABLE, AESNI, ARMV8 };
+
+	AesCbcDecryptor(const std::vector<unsigned char> &key,
+					Backend backend = preferredBackend())
+		: backend(backend) {
+		rkeys = plusaes::detail::expand_key(&key[0], (int)key.size());
+		rounds = (int)rkeys.size() - 1;
+		if(backend != PORTABLE) {
+			prepareDecryptionKeys();
+		}
+	}
+
+	/**
+	 * Decrypt len bytes (a multiple of 16) from in to out, which may be in
+	 * @param iv the chaining value, replaced by the last cipher block so
+	 * that consecutive calls continue the same stream
+	 */
+	void decrypt(const unsigned char *in, unsigned char *out, size_t len,
+				 unsigned char iv[16]) const {
+		size_t blocks = len / 16;
+		switch(backend) {
+#ifdef STARTER_AES_X86
+		case AESNI:
+			decryptAesNi(in, out, blocks, iv);
+			return;
+#endif
+#ifdef STARTER_AES_ARM
+		case ARMV8:
+			decryptArmV8(in, out, blocks, iv);
+			return;
+#endif
+		default:
+			decryptPortable(in, out, blocks, iv);
+		}
+	}
+
+	Backend getBackend() const { return backend; }
+
+	/// Whether this CPU can run backend b
+	static bool supported(Backend b) { return b == PORTABLE || b == hardwareBackend(); }
+
+	static const char *backendName(Backend b) {
+		switch(b) {
+		case AESNI:
+			return "AES-NI";
+		case ARMV8:
+			return "ARMv8 crypto";
+		default:
+			return "portable";
+		}
+	}
+
+	/**
+	 * Fastest backend available on this CPU. A hardware backend is only
+	 * chosen if it decrypts a reference stream exactly like plusaes.
+	 */
+	static Backend preferredBackend() {
+		static const Backend preferred = []() {
+			Backend hw = hardwareBackend();
+			if(hw == PORTABLE) {
+				return PORTABLE;
+			}
+
+			std::vector<unsigned char> key(16);
+			unsigned char data[19 * 16];
+			for(int i = 0; i < 16; i++) key[i] = (unsigned char)(i * 17 + 3);
+			for(int i = 0; i < (int)sizeof(data); i++) data[i] = (unsigned char)(i * 31 + 7);
+
+			unsigned char ivHw[16] = {}, ivRef[16] = {};
+			unsigned char outHw[sizeof(data)], outRef[sizeof(data)];
+			AesCbcDecryptor(key, hw).decrypt(data, outHw, sizeof(data), ivHw);
+			AesCbcDecryptor(key, PORTABLE).decrypt(data, outRef, sizeof(data), ivRef);
+			if(memcmp(outHw, outRef, sizeof(data)) != 0 ||
+			   memcmp(ivHw, ivRef, sizeof(ivHw)) != 0) {
+				std::cout << "WARNING: " << backendName(hw)
+						  << " AES self-check failed, using the portable decoder\n";
+				return PORTABLE;
+			}
+			return hw;
+		}();
+		return preferred;
+	}
+
+private:
+	Backend backend;
+	int rounds;
+	plusaes::detail::RoundKeys rkeys;
+	/// Round keys in the order of the equivalent inverse cipher
+	alignas(16) unsigned char dkeys[15][16];
+
+	static Backend hardwareBackend() {
+#if defined(STARTER_AES_X86) && defined(_MSC_VER)
+		int regs[4];
+		__cpuid(regs, 1);
+		if((regs[2] & (1 << 25)) && (regs[3] & (1 << 26))) {
+			return AESNI;
+		}
+#elif defined(STARTER_AES_X86)
+		unsigned int a, b, c, d;
+		if(__get_cpuid(1, &a, &b, &c, &d) && (c & bit_AES) && (d & bit_SSE2)) {
+			return AESNI;
+		}
+#elif defined(STARTER_AES_ARM) && defined(__linux__)
+		if(getauxval(AT_HWCAP) & HWCAP_AES) {
+			return ARMV8;
+		}
+#elif defined(STARTER_AES_ARM) && \
+	(defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES) || defined(_MSC_VER))
+		// built for a target that always has the crypto extension
+		return ARMV8;
+#endif
+		return PORTABLE;
+	}
+
+	void prepareDecryptionKeys() {
+		memcpy(dkeys[0], &rkeys[rounds], 16);
+		memcpy(dkeys[rounds], &rkeys[0], 16);
+		for(int r = 1; r < rounds; r++) {
+			memcpy(dkeys[r], &rkeys[rounds - r], 16);
+		}
+#ifdef STARTER_AES_X86
+		invMixColumnsAesNi(dkeys + 1, rounds - 1);
+#endif
+#ifdef STARTER_AES_ARM
+		invMixColumnsArmV8(dkeys + 1, rounds - 1);
+#endif
+	}
+
+	void decryptPortable(const unsigned char *in, unsigned char *out,
+						 size_t blocks, unsigned char iv[16]) const {
+		unsigned char cipher[16];
+		for(size_t i = 0; i < blocks; i++) {
+			memcpy(cipher, in + i * 16, 16);
+			plusaes::detail::decrypt_state(rkeys, cipher, out + i * 16);
+			plusaes::detail::xor_data(out + i * 16, iv);
+			memcpy(iv, cipher, 16);
+		}
+	}
+
+#ifdef STARTER_AES_X86
+	STARTER_AES_TARGET
+	static void invMixColumnsAesNi(unsigned char (*keys)[16], int count) {
+		for(int r = 0; r < count; r++) {
+			__m128i k = _mm_load_si128(reinterpret_cast<const __m128i *>(keys[r]));
+			_mm_store_si128(reinterpret_cast<__m128i *>(keys[r]), _mm_aesimc_si128(k));
+		}
+	}
+
+	STARTER_AES_TARGET
+	void decryptAesNi(const unsigned char *in, unsigned char *out,
+					  size_t blocks, unsigned char iv[16]) const {
+		const __m128i *src = reinterpret_cast<const __m128i *>(in);
+		__m128i *dst = reinterpret_cast<__m128i *>(out);
+		__m128i k[15];
+		for(int r = 0; r <= rounds; r++) {
+			k[r] = _mm_load_si128(reinterpret_cast<const __m128i *>(dkeys[r]));
+		}
+		__m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i *>(iv));
+
+		size_t i = 0;
+		for(; i + 8 <= blocks; i += 8) {
+			__m128i c[8], x[8];
+			for(int j = 0; j < 8; j++) {
+				c[j] = _mm_loadu_si128(src + i + j);
+				x[j] = _mm_xor_si128(c[j], k[0]);
+			}
+			for(int r = 1; r < rounds; r++) {
+				for(int j = 0; j < 8; j++) x[j] = _mm_aesdec_si128(x[j], k[r]);
+			}
+			for(int j = 0; j < 8; j++) x[j] = _mm_aesdeclast_si128(x[j], k[rounds]);
+
+			_mm_storeu_si128(dst + i, _mm_xor_si128(x[0], prev));
+			for(int j = 1; j < 8; j++) {
+				_mm_storeu_si128(dst + i + j, _mm_xor_si128(x[j], c[j - 1]));
+			}
+			prev = c[7];
+		}
+		for(; i < blocks; i++) {
+			__m128i c = _mm_loadu_si128(src + i);
+			__m128i x = _mm_xor_si128(c, k[0]);
+			for(int r = 1; r < rounds; r++) x = _mm_aesdec_si128(x, k[r]);
+			x = _mm_aesdeclast_si128(x, k[rounds]);
+			_mm_storeu_si128(dst + i, _mm_xor_si128(x, prev));
+			prev = c;
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(iv), prev);
+	}
+#endif
+
+#ifdef STARTER_AES_ARM
+	STARTER_AES_TARGET
+	static void invMixColumnsArmV8(unsigned char (*keys)[16], int count) {
+		for(int r = 0; r < count; r++) vst1q_u8(keys[r], vaesimcq_u8(vld1q_u8(keys[r])));
+	}
+
+	STARTER_AES_TARGET
+	void decryptArmV8(const unsigned char *in, unsigned char *out,
+					  size_t blocks, unsigned char iv[16]) const {
+		uint8x16_t k[15];
+		for(int r = 0; r <= rounds; r++) k[r] = vld1q_u8(dkeys[r]);
+		uint8x16_t prev = vld1q_u8(iv);
+
+		size_t i = 0;
+		for(; i + 8 <= blocks; i += 8) {
+			uint8x16_t c[8], x[8];
+			for(int j = 0; j < 8; j++) {
+				c[j] = vld1q_u8(in + (i + j) * 16);
+				x[j] = vaesdq_u8(c[j], k[0]);
+			}
+			for(int r = 1; r < rounds; r++) {
+				for(int j = 0; j < 8; j++) x[j] = vaesdq_u8(vaesimcq_u8(x[j]), k[r]);
+			}
+
+			vst1q_u8(out + i * 16, veorq_u8(veorq_u8(x[0], k[rounds]), prev));
+			for(int j = 1; j < 8; j++) {
+				vst1q_u8(out + (i + j) * 16,
+						 veorq_u8(veorq_u8(x[j], k[rounds]), c[j - 1]));
+			}
+			prev = c[7];
+		}
+		for(; i < blocks; i++) {
+			uint8x16_t c = vld1q_u8(in + i * 16);
+			uint8x16_t x = vaesdq_u8(c, k[0]);
+			for(int r = 1; r < rounds; r++) x = vaesdq_u8(vaesimcq_u8(x), k[r]);
+			vst1q_u8(out + i * 16, veorq_u8(veorq_u8(x, k[rounds]), prev));
+			prev = c;
+		}
+		vst1q_u8(iv, prev);
+	}
+#endif
+};
+
+/**
+ * Growable raw buffer: memory is kept between uses and only
+ * reallocated when a larger size is requested
+ */
+struct ScratchBuffer {
+	unsigned char *data = nullptr;
+	size_t capacity = 0;
+
+	ScratchBuffer() = default;
+	ScratchBuffer(const ScratchBuffer &) = delete;
+	ScratchBuffer &operator=(const ScratchBuffer &) = delete;
+	~ScratchBuffer() { free(data); }
+
+	unsigned char *reserve(size_t size) {
+		if(size > capacity) {
+			free(data);
+			capacity = std::max(size, capacity + capacity / 2);
+			data = static_cast<unsigned char *>(malloc(capacity));
+			if(data == nullptr) {
+				capacity = 0;
+				throw std::bad_alloc();
+			}
+		}
+		return data;
+	}
+};
+
+/**
+ * Scratch memory owned by each loader thread, reused by every
+ * asset decoded on that thread and released when the thread exits
+ */
+struct ScratchArena {
+	ScratchBuffer plain;
+	ScratchBuffer inflated;
+
+	static ScratchArena &local() {
+		thread_local ScratchArena arena;
+		return arena;
+	}
+};
+
+const size_t MGCG_CHUNK_SIZE = 64 * 1024;
+
+/**
+ * Decode an MGCG file (AES-128-CBC encrypted, deflated asset with a
+ * 16 bytes plain-text size header).
+ * The file is read and decrypted in place in chunks, then inflated,
+ * entirely inside the calling thread's scratch arena.
+ * @param file path of the .mgcg file
+ * @param size set to the size of the decoded payload
+ * @return the payload, valid until the next decode on the same thread
+ */
+const char *decodeMGCG(const std::string &file, size_t &size) {
+	static const AesCbcDecryptor aes(
+		plusaes::key_from_string(&"CG2023SkelKey128"));	// 16-char = 128-bit
+	const unsigned char iv0[16] = {
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+		0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+	};
+
+	std::ifstream in(file, std::ios::ate | std::ios::binary);
+	if(!in.is_open()) {
+		std::cout << "Failed to open: " << file << "\n";
+		throw std::runtime_error("failed to open file!");
+	}
+	size_t fileSize = (size_t)in.tellg();
+	in.seekg(0);
+
+	if(fileSize < 32 || fileSize % 16 != 0) {
+		throw std::runtime_error("invalid MGCG file: " + file);
+	}
+
+	ScratchArena &arena = ScratchArena::local();
+	unsigned char *plain = arena.plain.reserve(fileSize);
+
+	// Each chunk is decrypted in place right after it is read, while it
+	// is still in cache: CBC decryption of a chunk only needs the last
+	// cipher block of the previous one as IV, which decrypt() leaves in iv
+	unsigned char iv[16];
+	memcpy(iv, iv0, sizeof(iv));
+	size_t done = 0;
+	while(done < fileSize) {
+		size_t len = std::min(MGCG_CHUNK_SIZE, fileSize - done);
+		unsigned char *chunk = plain + done;
+		if(!in.read(reinterpret_cast<char *>(chunk), len)) {
+			throw std::runtime_error("failed to read MGCG file: " + file);
+		}
+
+		aes.decrypt(chunk, chunk, len, iv);
+		done += len;
+	}
+
+	// PKCS#7 padding: 1 to 16 bytes, all holding its length
+	size_t paddedSize = plain[fileSize - 1];
+	if(paddedSize == 0 || paddedSize > 16) {
+		throw std::runtime_error("failed to decrypt MGCG file: " + file);
+	}
+	for(size_t i = 0; i < paddedSize; i++) {
+		if(plain[fileSize - 1 - i] != paddedSize) {
+			throw std::runtime_error("failed to decrypt MGCG file: " + file);
+		}
+	}
+	size_t plainSize = fileSize - paddedSize;
+
+	char header[17] = {};
+	memcpy(header, plain, 16);
+	long inflatedSize = strtol(header, nullptr, 10);
+	if(inflatedSize <= 0) {
+		throw std::runtime_error("invalid MGCG header: " + file);
+	}
+
+	unsigned char *inflated = arena.inflated.reserve(inflatedSize);
+	int n = sinflate(inflated, (int)inflatedSize, plain + 16, (int)(plainSize - 16));
+	if(n != inflatedSize) {
+		throw std::runtime_error("failed to inflate MGCG file: " + file);
+	}
+
+	size = inflatedSize;
+	return reinterpret_cast<const char *>(inflated);
+}
+
+/// Bump whenever the loaders change what ends up in vertices/indices
+const uint32_t MESH_CACHE_VERSION = 4;
+/// Directory holding the mesh and texture caches
+const char ASSET_CACHE_DIR[] = "cache";
+
+/**
+ * Header of a binary mesh cache file, followed by the source path,
+ * the vertices and the indices
+ */
+struct MeshCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceTime;
+	uint64_t sourceSize;
+	uint64_t layoutHash;
+	uint32_t vertexSize;
+	uint32_t pathLength;
+	uint64_t vertexCount;
+	uint64_t indexCount;
+};
+
+/**
+ * Cache file used for a given model file and vertex layout: one flat
+ * directory, path separators replaced
+ */
+std::string meshCachePath(const std::string &file, uint64_t layoutHash) {
+	std::string name = file;
+	for(char &c : name) {
+		if(c == '/' || c == '\\' || c == ':') c = '_';
+	}
+	return std::string(ASSET_CACHE_DIR) + "/" + name + "." +
+		   std::to_string(layoutHash) + ".mshc";
+}
+
+
+class TransformInterpreter {
+public:
+	enum TransformType { UNKNOWN, TRANSLATE, ROTATE, SCALE };
+
+	static TransformType typeFromString(const std::string &type) {
+		if(type == "translate") return TRANSLATE;
+		if(type == "rotate") return ROTATE;
+		if(type == "scale") return SCALE;
+		return UNKNOWN;
+	}
+
+	/**
+	 * Append one transformation to a world matrix, so that it can be
+	 * evaluated as the transformations are read
+	 * @param Wm world matrix of the previous transformations
+	 * @param type kind of transformation (unknown ones are skipped)
+	 * @param v translation, rotation angles in degrees, or scale
+	 */
+	static void apply(glm::mat4 &Wm, TransformType type, const glm::vec3 &v) {
+		if(type == TRANSLATE) {
+			Wm *= glm::translate(glm::mat4(1.0f), v);
+		} else if(type == ROTATE) {
+			if(v.x != 0.0f)
+				Wm *= glm::rotate(glm::mat4(1.0f), glm::radians(v.x),
+								  glm::vec3(1.0f, 0.0f, 0.0f));
+			if(v.y != 0.0f)
+				Wm *= glm::rotate(glm::mat4(1.0f), glm::radians(v.y),
+								  glm::vec3(0.0f, 1.0f, 0.0f));
+			if(v.z != 0.0f)
+				Wm *= glm::rotate(glm::mat4(1.0f), glm::radians(v.z),
+								  glm::vec3(0.0f, 0.0f, 1.0f));
+		} else if(type == SCALE) {
+			Wm *= glm::scale(glm::mat4(1.0f), v);
+		}
+	}
+
+	/**
+	 * Compute world matrix from a list of transformations
+	 * @param transforms array of transformation objects (assumed to be valid)
+	 * @return the world matrix
+	 */
+	static glm::mat4 computeWorld(const nlohmann::json &transforms) {
+		glm::mat4 Wm = glm::mat4(1.0f);
+
+		for(auto &trans : transforms) {
+			glm::vec3 v(trans["vec"][0], trans["vec"][1], trans["vec"][2]);
+			apply(Wm, typeFromString(trans["type"]), v);
+		}
+
+		return Wm;
+	}
+};
+
+enum ModelType { OBJ, GLTF, GLB, MGCG };
+
+/**
+ * Map a scene.json "format" string to the model type
+ * (MGCG files may wrap either an ASCII glTF or a GLB payload)
+ */
+ModelType modelTypeFromString(const std::string &format) {
+	if(format == "OBJ") return OBJ;
+	if(format == "GLTF") return GLTF;
+	if(format == "GLB") return GLB;
+	if(format == "MGCG") return MGCG;
+	throw std::runtime_error("unknown model format: " + format);
+}
+
+/**
+ * What a texture holds, which decides the format it is stored in:
+ * sRGB RGBA for albedo, linear R8 for roughness and masks, linear R8G8
+ * for metallic/roughness pairs (read from the R and G channels)
+ */
+enum TextureSemantic { ALBEDO, ROUGHNESS, METALLIC_ROUGHNESS, MASK };
+
+TextureSemantic textureSemanticFromString(const std::string &semantic) {
+	if(semantic == "albedo") return ALBEDO;
+	if(semantic == "roughness") return ROUGHNESS;
+	if(semantic == "metallicRoughness") return METALLIC_ROUGHNESS;
+	if(semantic == "mask") return MASK;
+	throw std::runtime_error("unknown texture semantic: " + semantic);
+}
+
+struct VertexComponent {
+	bool hasIt;
+	uint32_t offset;
+};
+
+/**
+ * Where the loaders write each attribute inside a vertex
+ */
+struct VertexFormat {
+	VertexComponent Position;
+	VertexComponent Normal;
+	VertexComponent UV;
+	VertexComponent Color;
+	VertexComponent Tangent;
+	/// Size of a vertex
+	uint32_t stride = 0;
+	/// Tells layouts apart in the mesh cache, set from hashLayout()
+	uint64_t hash = 0;
+
+	uint64_t layoutHash() const { return hash; }
+
+	/**
+	 * FNV-1a over every field that changes what the loaders write in a
+	 * vertex
+	 */
+	uint64_t hashLayout() const {
+		uint64_t hash = 0xcbf29ce484222325ULL;
+		auto mix = [&hash](uint64_t v) {
+			for(int i = 0; i < 8; i++) {
+				hash ^= (v >> (8 * i)) & 0xFF;
+				hash *= 0x100000001b3ULL;
+			}
+		};
+
+		mix(stride);
+		for(const VertexComponent *c : {&Position, &Normal, &UV, &Color, &Tangent}) {
+			mix(c->hasIt);
+			mix(c->hasIt ? c->offset : 0);
+		}
+		return hash;
+	}
+};
+
+/**
+ * CPU side of a model: vertices and indices decoded from its file (or
+ * from the mesh cache), and the shapes collisions are tested against
+ */
+template<class Vert>
+class Mesh {
+protected:
+	/// Pending decoding started by loadAsync()
+	std::future<void> loading;
+
+public:
+	VertexFormat *VD;
+	std::vector<Vert> vertices{};
+	std::vector<uint32_t> indices{};
+	ModelBounds bounds;
+	/// Triangles for contacts finer than bounds
+	MeshBVH collisionMesh;
+	void loadModelOBJ(std::string file);
+	void loadModelGLTF(std::string file, ModelType MT);
+	bool loadCache(std::string file);
+	void storeCache(std::string file);
+	void computeBounds();
+	void buildCollisionMesh();
+
+	void load(std::string file, ModelType MT);
+	void loadAsync(VertexFormat *VD, std::string file, ModelType MT);
+	/// Wait for loadAsync(), throwing what the loader threw
+	void wait() { loading.get(); }
+
+	/// Never free a model the loader threads are still writing to
+	~Mesh() {
+		if(loading.valid()) loading.wait();
+	}
+};
+
+/**
+ * Face corner of an OBJ file: corners sharing the same
+ * position/normal/UV triple are collapsed into one vertex
+ */
+struct ObjIndexKey {
+	int vertex;
+	int normal;
+	int texcoord;
+
+	bool operator==(const ObjIndexKey &other) const {
+		return vertex == other.vertex && normal == other.normal &&
+			   texcoord == other.texcoord;
+	}
+};
+
+struct ObjIndexKeyHash {
+	size_t operator()(const ObjIndexKey &k) const {
+		size_t h = std::hash<int>()(k.vertex);
+		h = h * 31 + std::hash<int>()(k.normal);
+		h = h * 31 + std::hash<int>()(k.texcoord);
+		return h;
+	}
+};
+
+template<class Vert>
+void Mesh<Vert>::loadModelOBJ(std::string file) {
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string warn, err;
+
+	std::cout << "Loading : " << file << "[OBJ]\n";
+	if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, file.c_str())) {
+		throw std::runtime_error(warn + err);
+	}
+
+	std::cout << "Building\n";
+	size_t corners = 0;
+	for(const auto &shape : shapes) corners += shape.mesh.indices.size();
+
+	std::unordered_map<ObjIndexKey, uint32_t, ObjIndexKeyHash> uniqueVertices;
+	uniqueVertices.reserve(corners);
+	indices.reserve(corners);
+
+	for(const auto &shape : shapes) {
+		for(const auto &index : shape.mesh.indices) {
+			ObjIndexKey key = {index.vertex_index, index.normal_index,
+							   index.texcoord_index};
+			auto found = uniqueVertices.find(key);
+			if(found != uniqueVertices.end()) {
+				indices.push_back(found->second);
+				continue;
+			}
+
+			Vert vertex{};
+			glm::vec3 pos = {attrib.vertices[3 * index.vertex_index + 0],
+							 attrib.vertices[3 * index.vertex_index + 1],
+							 attrib.vertices[3 * index.vertex_index + 2]};
+			if(VD->Position.hasIt) {
+				glm::vec3 *o = (glm::vec3 *)((char *)(&vertex) + VD->Position.offset);
+				*o = pos;
+			}
+
+			glm::vec3 color = {attrib.colors[3 * index.vertex_index + 0],
+							   attrib.colors[3 * index.vertex_index + 1],
+							   attrib.colors[3 * index.vertex_index + 2]};
+			if(VD->Color.hasIt) {
+				glm::vec3 *o = (glm::vec3 *)((char *)(&vertex) + VD->Color.offset);
+				*o = color;
+			}
+
+			glm::vec2 texCoord = {attrib.texcoords[2 * index.texcoord_index + 0],
+								  1 - attrib.texcoords[2 * index.texcoord_index + 1]};
+			if(VD->UV.hasIt) {
+				glm::vec2 *o = (glm::vec2 *)((char *)(&vertex) + VD->UV.offset);
+				*o = texCoord;
+			}
+
+			glm::vec3 norm = {attrib.normals[3 * index.normal_index + 0],
+							  attrib.normals[3 * index.normal_index + 1],
+							  attrib.normals[3 * index.normal_index + 2]};
+			if(VD->Normal.hasIt) {
+				glm::vec3 *o = (glm::vec3 *)((char *)(&vertex) + VD->Normal.offset);
+				*o = norm;
+			}
+
+			uniqueVertices.emplace(key, static_cast<uint32_t>(vertices.size()));
+			indices.push_back(static_cast<uint32_t>(vertices.size()));
+			vertices.push_back(vertex);
+		}
+	}
+	std::cout << "[OBJ] Vertices: " << vertices.size() << " (from " << corners
+			  << " face corners)\n";
+	std::cout << "Indices: " << indices.size() << "\n";
+}
+
+template<class Vert>
+void Mesh<Vert>::loadModelGLTF(std::string file, ModelType MT) {
+	tinygltf::Model model;
+	tinygltf::TinyGLTF loader;
+	std::string warn, err;
+	bool ok = false;
+	const char *tag = (MT == MGCG) ? "[MGCG]" : ((MT == GLB) ? "[GLB]" : "[GLTF]");
+
+	std::cout << "Loading : " << file << tag << "\n";
+	if(MT == MGCG) {
+		size_t size = 0;
+		const char *decomp = decodeMGCG(file, size);
+
+		// a GLB payload starts with the "glTF" magic, JSON with '{'
+		if(size >= 4 && memcmp(decomp, "glTF", 4) == 0) {
+			ok = loader.LoadBinaryFromMemory(
+				&model, &warn, &err,
+				reinterpret_cast<const unsigned char *>(decomp),
+				(unsigned int)size, "/");
+		} else {
+			ok = loader.LoadASCIIFromString(&model, &warn, &err, decomp,
+											(unsigned int)size, "/");
+		}
+	} else if(MT == GLB) {
+		ok = loader.LoadBinaryFromFile(&model, &warn, &err, file.c_str());
+	} else {
+		ok = loader.LoadASCIIFromFile(&model, &warn, &err, file.c_str());
+	}
+	if(!ok) {
+		throw std::runtime_error(warn + err);
+	}
+
+	for(const auto &mesh : model.meshes) {
+		std::cout << "\tPrimitives: " << mesh.primitives.size() << "\n";
+		for(const auto &primitive : mesh.primitives) {
+			if(primitive.indices < 0) {
+				continue;
+			}
+
+			const float *bufferPos = nullptr;
+			const float *bufferNormals = nullptr;
+			const float *bufferTangents = nullptr;
+			const float *bufferTexCoords = nullptr;
+
+			bool meshHasPos = false;
+			bool meshHasNorm = false;
+			bool meshHasTan = false;
+			bool meshHasUV = false;
+
+			int cntPos = 0;
+			int cntNorm = 0;
+			int cntTan = 0;
+			int cntUV = 0;
+			int cntTot = 0;
+
+			auto pIt = primitive.attributes.find("POSITION");
+			if(pIt != primitive.attributes.end()) {
+				const tinygltf::Accessor &posAccessor = model.accessors[pIt->second];
+				const tinygltf::BufferView &posView =
+					model.bufferViews[posAccessor.bufferView];
+				bufferPos = reinterpret_cast<const float *>(
+					&(model.buffers[posView.buffer]
+						  .data[posAccessor.byteOffset + posView.byteOffset]));
+				meshHasPos = true;
+				cntPos = posAccessor.count;
+				if(cntPos > cntTot) cntTot = cntPos;
+			} else {
+				if(VD->Position.hasIt) {
+					std::cout << "Warning: vertex layout has position, but "
+								 "file hasn't\n";
+				}
+			}
+
+			auto nIt = primitive.attributes.find("NORMAL");
+			if(nIt != primitive.attributes.end()) {
+				const tinygltf::Accessor &normAccessor = model.accessors[nIt->second];
+				const tinygltf::BufferView &normView =
+					model.bufferViews[normAccessor.bufferView];
+				bufferNormals = reinterpret_cast<const float *>(
+					&(model.buffers[normView.buffer]
+						  .data[normAccessor.byteOffset + normView.byteOffset]));
+				meshHasNorm = true;
+				cntNorm = normAccessor.count;
+				if(cntNorm > cntTot) cntTot = cntNorm;
+			} else {
+				if(VD->Normal.hasIt) {
+					std::cout << "Warning: vertex layout has normal, but file "
+								 "hasn't\n";
+				}
+			}
+
+			auto tIt = primitive.attributes.find("TANGENT");
+			if(tIt != primitive.attributes.end()) {
+				const tinygltf::Accessor &tanAccessor = model.accessors[tIt->second];
+				const tinygltf::BufferView &tanView =
+					model.bufferViews[tanAccessor.bufferView];
+				bufferTangents = reinterpret_cast<const float *>(
+					&(model.buffers[tanView.buffer]
+						  .data[tanAccessor.byteOffset + tanView.byteOffset]));
+				meshHasTan = true;
+				cntTan = tanAccessor.count;
+				if(cntTan > cntTot) cntTot = cntTan;
+			} else {
+				if(VD->Tangent.hasIt) {
+					std::cout << "Warning: vertex layout has tangent, but file "
+								 "hasn't\n";
+				}
+			}
+
+			auto uIt = primitive.attributes.find("TEXCOORD_0");
+			if(uIt != primitive.attributes.end()) {
+				const tinygltf::Accessor &uvAccessor = model.accessors[uIt->second];
+				const tinygltf::BufferView &uvView =
+					model.bufferViews[uvAccessor.bufferView];
+				bufferTexCoords = reinterpret_cast<const float *>(
+					&(model.buffers[uvView.buffer]
+						  .data[uvAccessor.byteOffset + uvView.byteOffset]));
+				meshHasUV = true;
+				cntUV = uvAccessor.count;
+				if(cntUV > cntTot) cntTot = cntUV;
+			} else {
+				if(VD->UV.hasIt) {
+					std::cout
+						<< "Warning: vertex layout has UV, but file hasn't\n";
+				}
+			}
+
+			// Primitive indices start from their own first vertex
+			uint32_t base = vertices.size();
+			for(int i = 0; i < cntTot; i++) {
+				Vert vertex{};
+
+				if((i < cntPos) && meshHasPos && VD->Position.hasIt) {
+					glm::vec3 pos = {bufferPos[3 * i + 0], bufferPos[3 * i + 1],
+									 bufferPos[3 * i + 2]};
+					glm::vec3 *o =
+						(glm::vec3 *)((char *)(&vertex) + VD->Position.offset);
+					*o = pos;
+				}
+
+				if((i < cntNorm) && meshHasNorm && VD->Normal.hasIt) {
+					glm::vec3 normal = {bufferNormals[3 * i + 0],
+										bufferNormals[3 * i + 1],
+										bufferNormals[3 * i + 2]};
+					glm::vec3 *o =
+						(glm::vec3 *)((char *)(&vertex) + VD->Normal.offset);
+					*o = normal;
+				}
+
+				if((i < cntTan) && meshHasTan && VD->Tangent.hasIt) {
+					glm::vec4 tangent = {bufferTangents[4 * i + 0],
+										 bufferTangents[4 * i + 1],
+										 bufferTangents[4 * i + 2],
+										 bufferTangents[4 * i + 3]};
+					glm::vec4 *o =
+						(glm::vec4 *)((char *)(&vertex) + VD->Tangent.offset);
+					*o = tangent;
+				}
+
+				if((i < cntUV) && meshHasUV && VD->UV.hasIt) {
+					glm::vec2 texCoord = {bufferTexCoords[2 * i + 0],
+										  bufferTexCoords[2 * i + 1]};
+					glm::vec2 *o = (glm::vec2 *)((char *)(&vertex) + VD->UV.offset);
+					*o = texCoord;
+				}
+
+				vertices.push_back(vertex);
+			}
+
+			const tinygltf::Accessor &accessor = model.accessors[primitive.indices];
+			const tinygltf::BufferView &bufferView =
+				model.bufferViews[accessor.bufferView];
+			const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+
+			switch(accessor.componentType) {
+				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
+					const uint16_t *bufferIndex = reinterpret_cast<const uint16_t *>(
+						&(buffer.data[accessor.byteOffset + bufferView.byteOffset]));
+					for(int i = 0; i < accessor.count; i++) {
+						indices.push_back(base + bufferIndex[i]);
+					}
+				} break;
+				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
+					const uint32_t *bufferIndex = reinterpret_cast<const uint32_t *>(
+						&(buffer.data[accessor.byteOffset + bufferView.byteOffset]));
+					for(int i = 0; i < accessor.count; i++) {
+						indices.push_back(base + bufferIndex[i]);
+					}
+				} break;
+				default:
+					std::cerr << "Index component type " << accessor.componentType
+							  << " not supported!" << std::endl;
+					throw std::runtime_error("Error loading GLTF component");
+			}
+		}
+	}
+
+	std::cout << "\t" << tag
+			  << " Vertices: " << vertices.size()
+			  << "\n\tIndices: " << indices.size() << "\n";
+}
+
+template<class Vert>
+bool Mesh<Vert>::loadCache(std::string file) {
+	std::error_code ec;
+	auto sourceTime = std::filesystem::last_write_time(file, ec);
+	if(ec) return false;
+	auto sourceSize = std::filesystem::file_size(file, ec);
+	if(ec) return false;
+
+	MappedFile cache;
+	if(!cache.open(meshCachePath(file, VD->layoutHash()))) return false;
+
+	MeshCacheHeader header;
+	if(cache.size < sizeof(header)) return false;
+	memcpy(&header, cache.data, sizeof(header));
+
+	if(memcmp(header.magic, "MSHC", 4) != 0 || header.version != MESH_CACHE_VERSION ||
+	   header.sourceTime != (uint64_t)sourceTime.time_since_epoch().count() ||
+	   header.sourceSize != sourceSize || header.layoutHash != VD->layoutHash() ||
+	   header.vertexSize != sizeof(Vert) || header.pathLength != file.size()) {
+		return false;
+	}
+
+	size_t expected = sizeof(header) + header.pathLength +
+					  header.vertexCount * sizeof(Vert) +
+					  header.indexCount * sizeof(uint32_t);
+	if(cache.size != expected) return false;
+
+	const char *ptr = cache.data + sizeof(header);
+	if(file.compare(0, file.size(), ptr, header.pathLength) != 0) return false;
+	ptr += header.pathLength;
+
+	std::cout << "Loading : " << file << "[CACHE]\n";
+
+	vertices.resize(header.vertexCount);
+	memcpy(vertices.data(), ptr, header.vertexCount * sizeof(Vert));
+	ptr += header.vertexCount * sizeof(Vert);
+
+	indices.resize(header.indexCount);
+	memcpy(indices.data(), ptr, header.indexCount * sizeof(uint32_t));
+
+	std::cout << "\t[CACHE] Vertices: " << vertices.size()
+			  << "\n\tIndices: " << indices.size() << "\n";
+	return true;
+}
+
+template<class Vert>
+void Mesh<Vert>::storeCache(std::string file) {
+	std::error_code ec;
+	auto sourceTime = std::filesystem::last_write_time(file, ec);
+	if(ec) return;
+	auto sourceSize = std::filesystem::file_size(file, ec);
+	if(ec) return;
+
+	std::filesystem::create_directories(ASSET_CACHE_DIR, ec);
+	if(ec) {
+		std::cout << "Warning: cannot create " << ASSET_CACHE_DIR << "\n";
+		return;
+	}
+
+	MeshCacheHeader header{};
+	memcpy(header.magic, "MSHC", 4);
+	header.version = MESH_CACHE_VERSION;
+	header.sourceTime = (uint64_t)sourceTime.time_since_epoch().count();
+	header.sourceSize = sourceSize;
+	header.layoutHash = VD->layoutHash();
+	header.vertexSize = sizeof(Vert);
+	header.pathLength = file.size();
+	header.vertexCount = vertices.size();
+	header.indexCount = indices.size();
+
+	// Write aside and rename, so that a concurrent run never maps half a file
+	std::string cacheFile = meshCachePath(file, VD->layoutHash());
+	std::string tmpFile =
+		cacheFile + "." +
+		std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+		".tmp";
+	std::ofstream out(tmpFile, std::ios::binary | std::ios::trunc);
+	if(!out.is_open()) {
+		std::cout << "Warning: cannot write " << tmpFile << "\n";
+		return;
+	}
+
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	out.write(file.data(), file.size());
+	out.write(reinterpret_cast<const char *>(vertices.data()),
+			  vertices.size() * sizeof(Vert));
+	out.write(reinterpret_cast<const char *>(indices.data()),
+			  indices.size() * sizeof(uint32_t));
+	out.close();
+
+	if(!out) {
+		std::cout << "Warning: cannot write " << tmpFile << "\n";
+		std::filesystem::remove(tmpFile, ec);
+		return;
+	}
+
+	std::filesystem::rename(tmpFile, cacheFile, ec);
+	if(ec) std::filesystem::remove(tmpFile, ec);
+}
+
+template<class Vert>
+void Mesh<Vert>::computeBounds() {
+	bounds = ModelBounds();
+	if(!VD->Position.hasIt || vertices.empty()) return;
+
+	auto position = [this](const Vert &v) {
+		return *(const glm::vec3 *)((const char *)(&v) + VD->Position.offset);
+	};
+
+	bounds.min = bounds.max = position(vertices[0]);
+	for(const Vert &v : vertices) {
+		bounds.min = glm::min(bounds.min, position(v));
+		bounds.max = glm::max(bounds.max, position(v));
+	}
+
+	// Centered on the box, tighter than its half diagonal
+	bounds.center = (bounds.min + bounds.max) * 0.5f;
+	float radius2 = 0.0f;
+	for(const Vert &v : vertices) {
+		glm::vec3 d = position(v) - bounds.center;
+		radius2 = std::max(radius2, glm::dot(d, d));
+	}
+	bounds.radius = std::sqrt(radius2);
+}
+
+template<class Vert>
+void Mesh<Vert>::buildCollisionMesh() {
+	if(!VD->Position.hasIt) return;
+
+	std::vector<glm::vec3> positions(vertices.size());
+	for(size_t i = 0; i < vertices.size(); i++) {
+		positions[i] =
+			*(const glm::vec3 *)((const char *)(&vertices[i]) + VD->Position.offset);
+	}
+	collisionMesh.build(positions, indices);
+}
+
+template<class Vert>
+void Mesh<Vert>::load(std::string file, ModelType MT) {
+	if(!loadCache(file)) {
+		if(MT == OBJ) {
+			loadModelOBJ(file);
+		} else {
+			loadModelGLTF(file, MT);
+		}
+		storeCache(file);
+	}
+	computeBounds();
+	buildCollisionMesh();
+}
+
+template<class Vert>
+void Mesh<Vert>::loadAsync(VertexFormat *vd, std::string file, ModelType MT) {
+	VD = vd;
+	loading = loaderPool().submit([this, file, MT]() { load(file, MT); });
+}
@@ -0,0 +1,725 @@
+// Collision geometry, included by Starter.hpp once glm is configured
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define COLLISION_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#define COLLISION_NEON
+#include <arm_neon.h>
+#endif
+// Built for AVX2 (-mavx2, /arch:AVX2), eight lanes are available as well
+#if defined(__AVX2__)
+#define COLLISION_AVX2
+#include <immintrin.h>
+#endif
+
+enum CollisionType { COLLECTIBLE = 0, OBJECT = 1 };
+
+struct BoundingBox {
+	glm::vec3 min;
+	glm::vec3 max;
+	CollisionType cType;
+};
+
+/// Model space bounds, computed once when a model is loaded
+struct ModelBounds {
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+};
+
+/**
+ * World AABB of local bounds under an affine transform, in constant
+ * time (J. Arvo, "Transforming axis-aligned bounding boxes", 1990)
+ */
+void worldBounds(const ModelBounds &local, const glm::mat4 &Wm,
+				 glm::vec3 &min, glm::vec3 &max) {
+	min = max = glm::vec3(Wm[3]);
+	for(int j = 0; j < 3; j++) {
+		glm::vec3 a = glm::vec3(Wm[j]) * local.min[j];
+		glm::vec3 b = glm::vec3(Wm[j]) * local.max[j];
+		min += glm::min(a, b);
+		max += glm::max(a, b);
+	}
+}
+
+/**
+ * Earliest contact of a sphere moving from center to center + motion
+ * with box, as the fraction t of the motion. A sphere already touching
+ * the box only hits it when moving into it, so that it can slide along
+ * @return false if the sphere never touches the box
+ */
+bool sweepSphere(const glm::vec3 &center, float radius, const glm::vec3 &motion,
+				 const BoundingBox &box, float &t) {
+	auto distance2 = [&](float s) {
+		glm::vec3 p = center + motion * s;
+		glm::vec3 d = p - glm::clamp(p, box.min, box.max);
+		return glm::dot(d, d);
+	};
+
+	// Contact can only happen inside the box grown by radius
+	float enter = 0.0f;
+	float exit = 1.0f;
+	for(int i = 0; i < 3; i++) {
+		float lo = box.min[i] - radius;
+		float hi = box.max[i] + radius;
+		if(motion[i] == 0.0f) {
+			if(center[i] < lo || center[i] > hi) return false;
+			continue;
+		}
+		float a = (lo - center[i]) / motion[i];
+		float b = (hi - center[i]) / motion[i];
+		enter = std::max(enter, std::min(a, b));
+		exit = std::min(exit, std::max(a, b));
+		if(enter > exit) return false;
+	}
+
+	float r2 = radius * radius;
+	if(distance2(enter) <= r2) {
+		if(enter > 0.0f) {
+			t = enter;
+			return true;
+		}
+
+		// Centers inside the box are left to the overlap test
+		glm::vec3 outward = center - glm::clamp(center, box.min, box.max);
+		if(glm::dot(outward, outward) == 0.0f || glm::dot(outward, motion) >= 0.0f) {
+			return false;
+		}
+		t = 0.0f;
+		return true;
+	}
+
+	// Entering near an edge or a corner, where the grown box is rounded.
+	// The distance is convex along the motion: find its minimum, then
+	// the first point before it that is close enough
+	float lo = enter;
+	float hi = exit;
+	for(int i = 0; i < 32; i++) {
+		float m1 = lo + (hi - lo) / 3.0f;
+		float m2 = hi - (hi - lo) / 3.0f;
+		if(distance2(m1) < distance2(m2)) {
+			hi = m2;
+		} else {
+			lo = m1;
+		}
+	}
+	hi = (lo + hi) * 0.5f;
+	if(distance2(hi) > r2) return false;
+
+	lo = enter;
+	for(int i = 0; i < 24; i++) {
+		float mid = (lo + hi) * 0.5f;
+		if(distance2(mid) <= r2) {
+			hi = mid;
+		} else {
+			lo = mid;
+		}
+	}
+	t = hi;
+	return true;
+}
+
+/**
+ * Bounding volume hierarchy over axis aligned boxes, for broadphase
+ * overlap and ray queries. Boxes are identified by their index in the
+ * vector given to build(); moving a box refits the tree in place,
+ * adding or removing boxes needs a new build()
+ */
+class BVH {
+public:
+	void build(const std::vector<BoundingBox> &boxes) {
+		nodes.clear();
+		leaves.assign(boxes.size(), -1);
+		if(boxes.empty()) return;
+
+		std::vector<int> items(boxes.size());
+		std::iota(items.begin(), items.end(), 0);
+		nodes.reserve(2 * boxes.size() - 1);
+		buildNode(boxes, items, 0, items.size(), -1);
+	}
+
+	int size() const { return leaves.size(); }
+
+	/// Move box item, growing or shrinking only the ancestors that change
+	void refit(int item, const glm::vec3 &min, const glm::vec3 &max) {
+		int n = leaves[item];
+		if(nodes[n].min == min && nodes[n].max == max) return;
+		nodes[n].min = min;
+		nodes[n].max = max;
+
+		for(n = nodes[n].parent; n >= 0; n = nodes[n].parent) {
+			const Node &l = nodes[nodes[n].left];
+			const Node &r = nodes[nodes[n].right];
+			glm::vec3 lo = glm::min(l.min, r.min);
+			glm::vec3 hi = glm::max(l.max, r.max);
+			if(lo == nodes[n].min && hi == nodes[n].max) break;
+			nodes[n].min = lo;
+			nodes[n].max = hi;
+		}
+	}
+
+	/// Append to hits every box overlapping [min, max]
+	void overlaps(const glm::vec3 &min, const glm::vec3 &max,
+				  std::vector<int> &hits) const {
+		if(nodes.empty()) return;
+
+		int stack[STACK_SIZE];
+		int top = 0;
+		stack[top++] = 0;
+		while(top > 0) {
+			const Node &n = nodes[stack[--top]];
+			if(glm::any(glm::lessThan(n.max, min)) ||
+			   glm::any(glm::greaterThan(n.min, max))) {
+				continue;
+			}
+
+			if(n.item >= 0) {
+				hits.push_back(n.item);
+			} else {
+				stack[top++] = n.left;
+				stack[top++] = n.right;
+			}
+		}
+	}
+
+	/**
+	 * Nearest box along origin + t * dir, with 0 <= t <= maxT
+	 * @param t where the ray enters the box, 0 if origin is inside it
+	 * @return the box, or -1 if none is hit
+	 */
+	int raycast(const glm::vec3 &origin, const glm::vec3 &dir, float maxT,
+				float &t) const {
+		if(nodes.empty()) return -1;
+
+		glm::vec3 invDir = 1.0f / dir;
+		int hit = -1;
+		t = maxT;
+
+		float enter;
+		if(!slab(nodes[0], origin, invDir, t, enter)) return -1;
+
+		int stack[STACK_SIZE];
+		int top = 0;
+		stack[top++] = 0;
+		while(top > 0) {
+			const Node &n = nodes[stack[--top]];
+			if(!slab(n, origin, invDir, t, enter)) continue;
+
+			if(n.item >= 0) {
+				hit = n.item;
+				t = enter;
+				continue;
+			}
+
+			// Visit the nearer child first, so the farther one can be culled
+			float enterL, enterR;
+			bool hitL = slab(nodes[n.left], origin, invDir, t, enterL);
+			bool hitR = slab(nodes[n.right], origin, invDir, t, enterR);
+			if(hitL && hitR) {
+				bool leftFirst = enterL <= enterR;
+				stack[top++] = leftFirst ? n.right : n.left;
+				stack[top++] = leftFirst ? n.left : n.right;
+			} else if(hitL) {
+				stack[top++] = n.left;
+			} else if(hitR) {
+				stack[top++] = n.right;
+			}
+		}
+		return hit;
+	}
+
+private:
+	struct Node {
+		glm::vec3 min;
+		glm::vec3 max;
+		int parent;
+		/// Children of inner nodes
+		int left;
+		int right;
+		/// Box of a leaf, -1 for inner nodes
+		int item;
+	};
+
+	/// Median splits keep the depth at log2 of the box count
+	static const int STACK_SIZE = 64;
+
+	std::vector<Node> nodes;
+	/// Leaf node of each box
+	std::vector<int> leaves;
+
+	int buildNode(const std::vector<BoundingBox> &boxes, std::vector<int> &items,
+				  size_t begin, size_t end, int parent) {
+		int n = nodes.size();
+		nodes.push_back({boxes[items[begin]].min, boxes[items[begin]].max, parent,
+						 -1, -1, -1});
+
+		glm::vec3 cmin = boxes[items[begin]].min + boxes[items[begin]].max;
+		glm::vec3 cmax = cmin;
+		for(size_t i = begin; i < end; i++) {
+			const BoundingBox &b = boxes[items[i]];
+			nodes[n].min = glm::min(nodes[n].min, b.min);
+			nodes[n].max = glm::max(nodes[n].max, b.max);
+			cmin = glm::min(cmin, b.min + b.max);
+			cmax = glm::max(cmax, b.min + b.max);
+		}
+
+		if(end - begin == 1) {
+			nodes[n].item = items[begin];
+			leaves[items[begin]] = n;
+			return n;
+		}
+
+		// Split at the median centroid along the widest axis
+		glm::vec3 extent = cmax - cmin;
+		int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2)
+									   : (extent.y > extent.z ? 1 : 2);
+		size_t mid = begin + (end - begin) / 2;
+		std::nth_element(items.begin() + begin, items.begin() + mid,
+						 items.begin() + end, [&boxes, axis](int a, int b) {
+							 return boxes[a].min[axis] + boxes[a].max[axis] <
+									boxes[b].min[axis] + boxes[b].max[axis];
+						 });
+
+		int left = buildNode(boxes, items, begin, mid, n);
+		int right = buildNode(boxes, items, mid, end, n);
+		nodes[n].left = left;
+		nodes[n].right = right;
+		return n;
+	}
+
+	static bool slab(const Node &n, const glm::vec3 &origin, const glm::vec3 &invDir,
+					 float maxT, float &enter) {
+		glm::vec3 t0 = (n.min - origin) * invDir;
+		glm::vec3 t1 = (n.max - origin) * invDir;
+		glm::vec3 tmin = glm::min(t0, t1);
+		glm::vec3 tmax = glm::max(t0, t1);
+		enter = std::max(std::max(tmin.x, tmin.y), std::max(tmin.z, 0.0f));
+		float exit = std::min(std::min(tmax.x, tmax.y), std::min(tmax.z, maxT));
+		return enter <= exit;
+	}
+};
+
+/// Four lanes of the triangle kernel
+struct Float4 {
+#if defined(COLLISION_SSE)
+	__m128 v;
+#elif defined(COLLISION_NEON)
+	float32x4_t v;
+#else
+	float v[4];
+#endif
+};
+
+/// Per-lane comparison results, all bits set where true
+struct Mask4 {
+#if defined(COLLISION_SSE)
+	__m128 v;
+#elif defined(COLLISION_NEON)
+	uint32x4_t v;
+#else
+	bool v[4];
+#endif
+};
+
+#if defined(COLLISION_SSE)
+Float4 float4(float x) { return {_mm_set1_ps(x)}; }
+Float4 load4(const float *p) { return {_mm_loadu_ps(p)}; }
+void store4(float *p, Float4 a) { _mm_storeu_ps(p, a.v); }
+Float4 operator+(Float4 a, Float4 b) { return {_mm_add_ps(a.v, b.v)}; }
+Float4 operator-(Float4 a, Float4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+Float4 operator*(Float4 a, Float4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+Float4 operator/(Float4 a, Float4 b) { return {_mm_div_ps(a.v, b.v)}; }
+Float4 min(Float4 a, Float4 b) { return {_mm_min_ps(a.v, b.v)}; }
+Float4 max(Float4 a, Float4 b) { return {_mm_max_ps(a.v, b.v)}; }
+Float4 sqrt(Float4 a) { return {_mm_sqrt_ps(a.v)}; }
+Mask4 operator<(Float4 a, Float4 b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+Mask4 operator>(Float4 a, Float4 b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+Mask4 operator<=(Float4 a, Float4 b) { return {_mm_cmple_ps(a.v, b.v)}; }
+Mask4 operator>=(Float4 a, Float4 b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+Mask4 operator==(Float4 a, Float4 b) { return {_mm_cmpeq_ps(a.v, b.v)}; }
+Mask4 operator&(Mask4 a, Mask4 b) { return {_mm_and_ps(a.v, b.v)}; }
+Mask4 operator|(Mask4 a, Mask4 b) { return {_mm_or_ps(a.v, b.v)}; }
+/// Set in a and not in b
+Mask4 andNot(Mask4 a, Mask4 b) { return {_mm_andnot_ps(b.v, a.v)}; }
+bool any(Mask4 m) { return _mm_movemask_ps(m.v) != 0; }
+/// Set where the four bit sets have all the bits of key
+Mask4 held4(const uint32_t *keys, uint32_t key) {
+	__m128i k = _mm_set1_epi32(key);
+	__m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i *)keys), k);
+	return {_mm_castsi128_ps(_mm_cmpeq_epi32(b, k))};
+}
+/// a where m is set, b elsewhere
+Float4 select(Mask4 m, Float4 a, Float4 b) {
+	return {_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v))};
+}
+#elif defined(COLLISION_NEON)
+Float4 float4(float x) { return {vdupq_n_f32(x)}; }
+Float4 load4(const float *p) { return {vld1q_f32(p)}; }
+void store4(float *p, Float4 a) { vst1q_f32(p, a.v); }
+Float4 operator+(Float4 a, Float4 b) { return {vaddq_f32(a.v, b.v)}; }
+Float4 operator-(Float4 a, Float4 b) { return {vsubq_f32(a.v, b.v)}; }
+Float4 operator*(Float4 a, Float4 b) { return {vmulq_f32(a.v, b.v)}; }
+Float4 operator/(Float4 a, Float4 b) {
+#ifdef __aarch64__
+	return {vdivq_f32(a.v, b.v)};
+#else
+	// Two Newton steps from the estimate, ARMv7 has no vector division
+	float32x4_t r = vrecpeq_f32(b.v);
+	r = vmulq_f32(r, vrecpsq_f32(b.v, r));
+	r = vmulq_f32(r, vrecpsq_f32(b.v, r));
+	return {vmulq_f32(a.v, r)};
+#endif
+}
+Float4 min(Float4 a, Float4 b) { return {vminq_f32(a.v, b.v)}; }
+Float4 max(Float4 a, Float4 b) { return {vmaxq_f32(a.v, b.v)}; }
+Float4 sqrt(Float4 a) {
+#ifdef __aarch64__
+	return {vsqrtq_f32(a.v)};
+#else
+	// a / sqrt(a) from the refined estimate, zero where a is
+	float32x4_t r = vrsqrteq_f32(a.v);
+	r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(a.v, r), r));
+	r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(a.v, r), r));
+	uint32x4_t zero = vceqq_f32(a.v, vdupq_n_f32(0.0f));
+	return {vbslq_f32(zero, a.v, vmulq_f32(a.v, r))};
+#endif
+}
+Mask4 operator<(Float4 a, Float4 b) { return {vcltq_f32(a.v, b.v)}; }
+Mask4 operator>(Float4 a, Float4 b) { return {vcgtq_f32(a.v, b.v)}; }
+Mask4 operator<=(Float4 a, Float4 b) { return {vcleq_f32(a.v, b.v)}; }
+Mask4 operator>=(Float4 a, Float4 b) { return {vcgeq_f32(a.v, b.v)}; }
+Mask4 operator==(Float4 a, Float4 b) { return {vceqq_f32(a.v, b.v)}; }
+Mask4 operator&(Mask4 a, Mask4 b) { return {vandq_u32(a.v, b.v)}; }
+Mask4 operator|(Mask4 a, Mask4 b) { return {vorrq_u32(a.v, b.v)}; }
+Mask4 andNot(Mask4 a, Mask4 b) { return {vbicq_u32(a.v, b.v)}; }
+bool any(Mask4 m) {
+	uint32x2_t half = vorr_u32(vget_low_u32(m.v), vget_high_u32(m.v));
+	return (vget_lane_u32(half, 0) | vget_lane_u32(half, 1)) != 0;
+}
+Mask4 held4(const uint32_t *keys, uint32_t key) {
+	uint32x4_t k = vdupq_n_u32(key);
+	return {vceqq_u32(vandq_u32(vld1q_u32(keys), k), k)};
+}
+Float4 select(Mask4 m, Float4 a, Float4 b) { return {vbslq_f32(m.v, a.v, b.v)}; }
+#else
+Float4 float4(float x) { return {{x, x, x, x}}; }
+Float4 load4(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+void store4(float *p, Float4 a) {
+	for(int i = 0; i < 4; i++) p[i] = a.v[i];
+}
+#define COLLISION_LANEWISE(RESULT, OP)        \
+	RESULT r;                                 \
+	for(int i = 0; i < 4; i++) r.v[i] = (OP); \
+	return r;
+Float4 operator+(Float4 a, Float4 b) { COLLISION_LANEWISE(Float4, a.v[i] + b.v[i]) }
+Float4 operator-(Float4 a, Float4 b) { COLLISION_LANEWISE(Float4, a.v[i] - b.v[i]) }
+Float4 operator*(Float4 a, Float4 b) { COLLISION_LANEWISE(Float4, a.v[i] * b.v[i]) }
+Float4 operator/(Float4 a, Float4 b) { COLLISION_LANEWISE(Float4, a.v[i] / b.v[i]) }
+Float4 min(Float4 a, Float4 b) { COLLISION_LANEWISE(Float4, a.v[i] < b.v[i] ? a.v[i] : b.v[i]) }
+Float4 max(Float4 a, Float4 b) { COLLISION_LANEWISE(Float4, a.v[i] > b.v[i] ? a.v[i] : b.v[i]) }
+Float4 sqrt(Float4 a) { COLLISION_LANEWISE(Float4, std::sqrt(a.v[i])) }
+Mask4 operator<(Float4 a, Float4 b) { COLLISION_LANEWISE(Mask4, a.v[i] < b.v[i]) }
+Mask4 operator>(Float4 a, Float4 b) { COLLISION_LANEWISE(Mask4, a.v[i] > b.v[i]) }
+Mask4 operator<=(Float4 a, Float4 b) { COLLISION_LANEWISE(Mask4, a.v[i] <= b.v[i]) }
+Mask4 operator>=(Float4 a, Float4 b) { COLLISION_LANEWISE(Mask4, a.v[i] >= b.v[i]) }
+Mask4 operator==(Float4 a, Float4 b) { COLLISION_LANEWISE(Mask4, a.v[i] == b.v[i]) }
+Mask4 operator&(Mask4 a, Mask4 b) { COLLISION_LANEWISE(Mask4, a.v[i] && b.v[i]) }
+Mask4 operator|(Mask4 a, Mask4 b) { COLLISION_LANEWISE(Mask4, a.v[i] || b.v[i]) }
+Mask4 andNot(Mask4 a, Mask4 b) { COLLISION_LANEWISE(Mask4, a.v[i] && !b.v[i]) }
+bool any(Mask4 m) { return m.v[0] || m.v[1] || m.v[2] || m.v[3]; }
+Mask4 held4(const uint32_t *keys, uint32_t key) {
+	COLLISION_LANEWISE(Mask4, (keys[i] & key) == key)
+}
+Float4 select(Mask4 m, Float4 a, Float4 b) {
+	COLLISION_LANEWISE(Float4, m.v[i] ? a.v[i] : b.v[i])
+}
+#undef COLLISION_LANEWISE
+#endif
+
+Float4 dot3(const Float4 a[3], const Float4 b[3]) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+#ifdef COLLISION_AVX2
+/// Eight lanes, with the operations of Float4
+struct Float8 {
+	__m256 v;
+};
+
+struct Mask8 {
+	__m256 v;
+};
+
+Float8 float8(float x) { return {_mm256_set1_ps(x)}; }
+Float8 load8(const float *p) { return {_mm256_loadu_ps(p)}; }
+void store8(float *p, Float8 a) { _mm256_storeu_ps(p, a.v); }
+Float8 operator+(Float8 a, Float8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+Float8 operator-(Float8 a, Float8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+Float8 operator*(Float8 a, Float8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+Float8 operator/(Float8 a, Float8 b) { return {_mm256_div_ps(a.v, b.v)}; }
+Float8 min(Float8 a, Float8 b) { return {_mm256_min_ps(a.v, b.v)}; }
+Float8 max(Float8 a, Float8 b) { return {_mm256_max_ps(a.v, b.v)}; }
+Float8 sqrt(Float8 a) { return {_mm256_sqrt_ps(a.v)}; }
+Mask8 operator<(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+Mask8 operator>(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+Mask8 operator<=(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)}; }
+Mask8 operator>=(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)}; }
+Mask8 operator==(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)}; }
+Mask8 operator&(Mask8 a, Mask8 b) { return {_mm256_and_ps(a.v, b.v)}; }
+Mask8 operator|(Mask8 a, Mask8 b) { return {_mm256_or_ps(a.v, b.v)}; }
+Mask8 andNot(Mask8 a, Mask8 b) { return {_mm256_andnot_ps(b.v, a.v)}; }
+bool any(Mask8 m) { return _mm256_movemask_ps(m.v) != 0; }
+Mask8 held8(const uint32_t *keys, uint32_t key) {
+	__m256i k = _mm256_set1_epi32(key);
+	__m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)keys), k);
+	return {_mm256_castsi256_ps(_mm256_cmpeq_epi32(b, k))};
+}
+Float8 select(Mask8 m, Float8 a, Float8 b) { return {_mm256_blendv_ps(b.v, a.v, m.v)}; }
+
+Float8 dot3(const Float8 a[3], const Float8 b[3]) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+#endif
+
+/**
+ * Closest point to p on four triangles at once, and its squared
+ * distance. The Voronoi regions of Ericson's ClosestPtPointTriangle
+ * (Real-Time Collision Detection, 5.1.5) are selected without branches,
+ * the last assignment being the first region tested there
+ */
+void closestPointTriangles4(const Float4 p[3], const Float4 a[3], const Float4 b[3],
+							const Float4 c[3], Float4 q[3], Float4 &distance2) {
+	Float4 ab[3], ac[3], ap[3], bp[3], cp[3];
+	for(int i = 0; i < 3; i++) {
+		ab[i] = b[i] - a[i];
+		ac[i] = c[i] - a[i];
+		ap[i] = p[i] - a[i];
+		bp[i] = p[i] - b[i];
+		cp[i] = p[i] - c[i];
+	}
+	Float4 d1 = dot3(ab, ap), d2 = dot3(ac, ap);
+	Float4 d3 = dot3(ab, bp), d4 = dot3(ac, bp);
+	Float4 d5 = dot3(ab, cp), d6 = dot3(ac, cp);
+	Float4 va = d3 * d6 - d5 * d4;
+	Float4 vb = d5 * d2 - d1 * d6;
+	Float4 vc = d1 * d4 - d3 * d2;
+
+	Float4 zero = float4(0.0f), one = float4(1.0f);
+
+	// Barycentric weights of b and c, from the face inward
+	Float4 denom = one / (va + vb + vc);
+	Float4 v = vb * denom;
+	Float4 w = vc * denom;
+
+	Float4 e1 = d4 - d3, e2 = d5 - d6;
+	Mask4 edgeBC = (va <= zero) & (e1 >= zero) & (e2 >= zero);
+	Float4 wBC = e1 / (e1 + e2);
+	v = select(edgeBC, one - wBC, v);
+	w = select(edgeBC, wBC, w);
+
+	Mask4 edgeAC = (vb <= zero) & (d2 >= zero) & (d6 <= zero);
+	v = select(edgeAC, zero, v);
+	w = select(edgeAC, d2 / (d2 - d6), w);
+
+	Mask4 vertexC = (d6 >= zero) & (d5 <= d6);
+	v = select(vertexC, zero, v);
+	w = select(vertexC, one, w);
+
+	Mask4 edgeAB = (vc <= zero) & (d1 >= zero) & (d3 <= zero);
+	v = select(edgeAB, d1 / (d1 - d3), v);
+	w = select(edgeAB, zero, w);
+
+	Mask4 vertexB = (d3 >= zero) & (d4 <= d3);
+	v = select(vertexB, one, v);
+	w = select(vertexB, zero, w);
+
+	Mask4 vertexA = (d1 <= zero) & (d2 <= zero);
+	v = select(vertexA, zero, v);
+	w = select(vertexA, zero, w);
+
+	Float4 d[3];
+	for(int i = 0; i < 3; i++) {
+		q[i] = a[i] + ab[i] * v + ac[i] * w;
+		d[i] = p[i] - q[i];
+	}
+	distance2 = dot3(d, d);
+}
+
+/**
+ * Triangle BVH of a mesh, in model space, for sphere contacts accurate
+ * to the triangles. Leaves hold four triangles, laid out for
+ * closestPointTriangles4()
+ */
+class MeshBVH {
+public:
+	void build(const std::vector<glm::vec3> &positions,
+			   const std::vector<uint32_t> &indices) {
+		nodes.clear();
+		blocks.clear();
+		size_t count = indices.size() / 3;
+		if(count == 0) return;
+
+		std::vector<Triangle> triangles(count);
+		for(size_t t = 0; t < count; t++) {
+			for(int k = 0; k < 3; k++) {
+				triangles[t].v[k] = positions[indices[3 * t + k]];
+			}
+		}
+		nodes.reserve(2 * (count / 4 + 1));
+		blocks.reserve(count / 4 + 1);
+		buildNode(triangles, 0, count);
+	}
+
+	bool empty() const { return nodes.empty(); }
+
+	/**
+	 * Point of the mesh placed in the world by Wm that is nearest to p,
+	 * if it is closer than maxDistance
+	 */
+	bool nearest(const glm::mat4 &Wm, const glm::vec3 &p, float maxDistance,
+				 glm::vec3 &point) const {
+		if(nodes.empty()) return false;
+
+		// Model space box holding every point within maxDistance of p
+		glm::mat4 invWm = glm::inverse(Wm);
+		ModelBounds query;
+		query.min = p - maxDistance;
+		query.max = p + maxDistance;
+		glm::vec3 lo, hi;
+		worldBounds(query, invWm, lo, hi);
+
+		Float4 P[3] = {float4(p.x), float4(p.y), float4(p.z)};
+		float best2 = maxDistance * maxDistance;
+		bool found = false;
+
+		int stack[STACK_SIZE];
+		int top = 0;
+		stack[top++] = 0;
+		while(top > 0) {
+			const Node &n = nodes[stack[--top]];
+			if(glm::any(glm::lessThan(n.max, lo)) ||
+			   glm::any(glm::greaterThan(n.min, hi))) {
+				continue;
+			}
+			if(n.block < 0) {
+				stack[top++] = n.left;
+				stack[top++] = n.right;
+				continue;
+			}
+
+			// Corners to world space, then the four triangles at once
+			const TriangleBlock &B = blocks[n.block];
+			Float4 V[3][3];
+			for(int k = 0; k < 3; k++) {
+				Float4 x = load4(B.v[k][0]), y = load4(B.v[k][1]), z = load4(B.v[k][2]);
+				for(int i = 0; i < 3; i++) {
+					V[k][i] = float4(Wm[0][i]) * x + float4(Wm[1][i]) * y +
+							  float4(Wm[2][i]) * z + float4(Wm[3][i]);
+				}
+			}
+			Float4 Q[3], D2;
+			closestPointTriangles4(P, V[0], V[1], V[2], Q, D2);
+
+			alignas(16) float d2[4], qx[4], qy[4], qz[4];
+			store4(d2, D2);
+			store4(qx, Q[0]);
+			store4(qy, Q[1]);
+			store4(qz, Q[2]);
+			for(int i = 0; i < 4; i++) {
+				if(d2[i] < best2) {
+					best2 = d2[i];
+					point = glm::vec3(qx[i], qy[i], qz[i]);
+					found = true;
+				}
+			}
+			if(found) {
+				// Only nearer triangles are left to look for
+				float d = std::sqrt(best2);
+				query.min = p - d;
+				query.max = p + d;
+				worldBounds(query, invWm, lo, hi);
+			}
+		}
+		return found;
+	}
+
+private:
+	struct Triangle {
+		glm::vec3 v[3];
+	};
+
+	/// Corner, axis, lane: four triangles, the last repeated as padding
+	struct TriangleBlock {
+		float v[3][3][4];
+	};
+
+	struct Node {
+		glm::vec3 min;
+		glm::vec3 max;
+		int left;
+		int right;
+		/// Triangles of a leaf, -1 for inner nodes
+		int block;
+	};
+
+	/// Median splits keep the depth at log2 of the leaf count
+	static const int STACK_SIZE = 64;
+
+	std::vector<Node> nodes;
+	std::vector<TriangleBlock> blocks;
+
+	int buildNode(std::vector<Triangle> &triangles, size_t begin, size_t end) {
+		int n = nodes.size();
+		nodes.push_back({triangles[begin].v[0], triangles[begin].v[0], -1, -1, -1});
+
+		glm::vec3 cmin = triangles[begin].v[0] * 3.0f;
+		glm::vec3 cmax = cmin;
+		for(size_t t = begin; t < end; t++) {
+			const Triangle &T = triangles[t];
+			for(int k = 0; k < 3; k++) {
+				nodes[n].min = glm::min(nodes[n].min, T.v[k]);
+				nodes[n].max = glm::max(nodes[n].max, T.v[k]);
+			}
+			glm::vec3 centroid = T.v[0] + T.v[1] + T.v[2];
+			cmin = glm::min(cmin, centroid);
+			cmax = glm::max(cmax, centroid);
+		}
+
+		if(end - begin <= 4) {
+			TriangleBlock B;
+			for(int i = 0; i < 4; i++) {
+				const Triangle &T = triangles[std::min(begin + i, end - 1)];
+				for(int k = 0; k < 3; k++) {
+					for(int a = 0; a < 3; a++) B.v[k][a][i] = T.v[k][a];
+				}
+			}
+			nodes[n].block = blocks.size();
+			blocks.push_back(B);
+			return n;
+		}
+
+		// Split at the median centroid along the widest axis
+		glm::vec3 extent = cmax - cmin;
+		int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2)
+									   : (extent.y > extent.z ? 1 : 2);
+		size_t mid = begin + (end - begin) / 2;
+		std::nth_element(triangles.begin() + begin, triangles.begin() + mid,
+						 triangles.begin() + end,
+						 [axis](const Triangle &a, const Triangle &b) {
+							 return a.v[0][axis] + a.v[1][axis] + a.v[2][axis] <
+									b.v[0][axis] + b.v[1][axis] + b.v[2][axis];
+						 });
+
+		int left = buildNode(triangles, begin, mid);
+		int right = buildNode(triangles, mid, end);
+		nodes[n].left = left;
+		nodes[n].right = right;
+		return n;
+	}
+};
@@ -0,0 +1,499 @@
+// Many rockets stepped at once on the static scene, for tuning sweeps:
+// the rocket update of Simulation::tick() on arrays of rockets, a SIMD
+// register of them at a time. Included after Simulation.hpp
+
+#ifdef COLLISION_AVX2
+/// Rockets stepped together, eight of them with AVX2, four otherwise
+typedef Float8 RocketLanes;
+typedef Mask8 RocketMask;
+const int ROCKET_LANES = 8;
+RocketLanes rocketLanes(float x) { return float8(x); }
+RocketLanes loadLanes(const float *p) { return load8(p); }
+void storeLanes(float *p, RocketLanes a) { store8(p, a); }
+RocketMask heldLanes(const uint32_t *keys, uint32_t key) { return held8(keys, key); }
+#else
+typedef Float4 RocketLanes;
+typedef Mask4 RocketMask;
+const int ROCKET_LANES = 4;
+RocketLanes rocketLanes(float x) { return float4(x); }
+RocketLanes loadLanes(const float *p) { return load4(p); }
+void storeLanes(float *p, RocketLanes a) { store4(p, a); }
+RocketMask heldLanes(const uint32_t *keys, uint32_t key) { return held4(keys, key); }
+#endif
+
+/**
+ * Rockets flying the boxes of a scene side by side, each one with its
+ * own keys and RocketParams. Every rocket moves as the one of Simulation
+ * with meshCollision off: coins are left out, as collecting them does
+ * not change the flight, and the camera is not turned
+ */
+class RocketBatch {
+public:
+	/// Keys held by each rocket in the next step()
+	std::vector<uint32_t> keys;
+
+	/**
+	 * Start count rockets where the one of sim is, params being repeated
+	 * if shorter, colliding with the OBJECT boxes of sim.bbMap
+	 */
+	void init(const Simulation &sim, const std::vector<RocketParams> &params,
+			  size_t count) {
+		if(params.empty()) throw std::runtime_error("no rocket parameters!");
+		this->count = count;
+		size_t padded = (count + ROCKET_LANES - 1) / ROCKET_LANES * ROCKET_LANES;
+
+		deltaT = sim.DELTA_T;
+		sweepSteps = sim.MAX_SWEEP_STEPS;
+		contactSkin = sim.CONTACT_SKIN;
+		radius = sim.rocketCollider.radius;
+
+		keys.assign(padded, 0);
+		for(int i = 0; i < 3; i++) {
+			position[i].assign(padded, sim.rocketPosition[i]);
+			speed[i].assign(padded, sim.rocketSpeed[i]);
+			resting[i].assign(padded, sim.restingPosition[i]);
+		}
+		rotationX.assign(padded, sim.rocketRotation.x);
+		rotationY.assign(padded, sim.rocketRotation.y);
+		rotHor.assign(padded, sim.rocketRotHor);
+		rotVert.assign(padded, sim.rocketRotVert);
+		verticalSpeed.assign(padded, sim.rocketVerticalSpeed);
+		isResting.assign(padded, sim.rocketState == RESTING ? 1.0f : 0.0f);
+		wasGoingRight.assign(padded, sim.wasGoingRight ? 1.0f : 0.0f);
+		wasGoingUp.assign(padded, sim.wasGoingUp ? 1.0f : 0.0f);
+
+		moveSpeed.resize(padded);
+		gravity.resize(padded);
+		tilt.resize(padded);
+		maxTilt.resize(padded);
+		stabilizeThreshold.resize(padded);
+		straighten.resize(padded);
+		for(size_t i = 0; i < padded; i++) {
+			const RocketParams &p = params[std::min(i, count - 1) % params.size()];
+			moveSpeed[i] = p.moveSpeed;
+			gravity[i] = p.gravity;
+			tilt[i] = p.tiltSpeed * deltaT;
+			maxTilt[i] = p.maxTilt;
+			stabilizeThreshold[i] = p.stabilizeThreshold;
+			straighten[i] = std::exp(-p.stabilizeRate * deltaT);
+		}
+
+		for(int k = 0; k < 2; k++) {
+			sines[k].resize(padded);
+			cosines[k].resize(padded);
+			trigAngle[k].assign(padded, NAN);
+		}
+
+		// In the order Simulation resolves its contacts
+		std::vector<std::string> ids;
+		for(auto &bb : sim.bbMap) {
+			if(bb.second.cType == OBJECT) ids.push_back(bb.first);
+		}
+		std::sort(ids.begin(), ids.end());
+		boxes.clear();
+		for(auto &id : ids) boxes.push_back(sim.bbMap.at(id));
+		tree.build(boxes);
+	}
+
+	size_t size() const { return count; }
+
+	glm::vec3 rocketPosition(size_t i) const {
+		return {position[0][i], position[1][i], position[2][i]};
+	}
+
+	RocketState rocketState(size_t i) const {
+		return isResting[i] != 0.0f ? RESTING : MOVING;
+	}
+
+	/**
+	 * Advance every rocket by DELTA_T with its keys
+	 */
+	void step() {
+		for(size_t o = 0; o < keys.size(); o += ROCKET_LANES) stepLanes(o);
+	}
+
+	/// Advance every rocket with the same keys
+	void step(const SimInput &input) {
+		std::fill(keys.begin(), keys.end(), input.keys);
+		step();
+	}
+
+private:
+	float deltaT;
+	int sweepSteps;
+	float contactSkin;
+	float radius;
+	size_t count = 0;
+
+	// Structure of arrays, one entry per rocket
+	std::vector<float> position[3];
+	std::vector<float> speed[3];
+	std::vector<float> resting[3];
+	std::vector<float> rotationX, rotationY;
+	std::vector<float> rotHor, rotVert;
+	std::vector<float> verticalSpeed;
+	/// 1 where true, 0 where false
+	std::vector<float> isResting, wasGoingRight, wasGoingUp;
+	// Parameters, DELTA_T already applied to the turn rates
+	std::vector<float> moveSpeed, gravity, tilt, maxTilt, stabilizeThreshold;
+	std::vector<float> straighten;
+
+	/// Sines and cosines of the rotation about x and y, for the angles in
+	/// trigAngle
+	std::vector<float> sines[2], cosines[2], trigAngle[2];
+
+	std::vector<BoundingBox> boxes;
+	/// Broadphase over boxes, and the last boxes it found
+	BVH tree;
+	std::vector<int> candidates;
+
+	/**
+	 * Sine and cosine of the rotation about axis k (x or y) of rocket i.
+	 * They come from libm as in glm::rotate(), for the thrust to be the
+	 * one of Simulation to the bit, and are kept until the rocket turns
+	 */
+	void turn(int k, size_t i, float angle) {
+		if(angle == trigAngle[k][i]) return;
+		trigAngle[k][i] = angle;
+		sines[k][i] = std::sin(glm::radians(angle));
+		cosines[k][i] = std::cos(glm::radians(angle));
+	}
+
+	/**
+	 * Boxes overlapping [lo, hi] on any lane of mask, in the order of
+	 * boxes, which is the order Simulation resolves its contacts in
+	 */
+	const std::vector<int> &query(RocketMask mask, const RocketLanes lo[3],
+								  const RocketLanes hi[3]) {
+		RocketLanes far = rocketLanes(INFINITY);
+		float l[ROCKET_LANES], h[ROCKET_LANES];
+		glm::vec3 min(INFINITY), max(-INFINITY);
+		for(int i = 0; i < 3; i++) {
+			storeLanes(l, select(mask, lo[i], far));
+			storeLanes(h, select(mask, hi[i], rocketLanes(0.0f) - far));
+			for(int k = 0; k < ROCKET_LANES; k++) {
+				min[i] = std::min(min[i], l[k]);
+				max[i] = std::max(max[i], h[k]);
+			}
+		}
+
+		candidates.clear();
+		tree.overlaps(min, max, candidates);
+		std::sort(candidates.begin(), candidates.end());
+		return candidates;
+	}
+
+	/// Box of the scene, broadcast to every lane
+	struct BoxLanes {
+		RocketLanes min[3];
+		RocketLanes max[3];
+
+		explicit BoxLanes(const BoundingBox &box) {
+			for(int i = 0; i < 3; i++) {
+				min[i] = rocketLanes(box.min[i]);
+				max[i] = rocketLanes(box.max[i]);
+			}
+		}
+	};
+
+	static void clampToBox(const RocketLanes p[3], const RocketLanes lo[3],
+						   const RocketLanes hi[3], RocketLanes q[3]) {
+		for(int i = 0; i < 3; i++) q[i] = min(max(p[i], lo[i]), hi[i]);
+	}
+
+	/// Squared distance from center + motion * s to the box
+	static RocketLanes distance2(const RocketLanes center[3], const RocketLanes motion[3],
+								 const BoxLanes &box, RocketLanes s) {
+		RocketLanes p[3], q[3], d[3];
+		for(int i = 0; i < 3; i++) p[i] = center[i] + motion[i] * s;
+		clampToBox(p, box.min, box.max, q);
+		for(int i = 0; i < 3; i++) d[i] = p[i] - q[i];
+		return dot3(d, d);
+	}
+
+	/// The broadphase test of BVH::overlaps(), lanes overlapping [lo, hi]
+	static RocketMask overlaps(const BoxLanes &box, const RocketLanes lo[3],
+							   const RocketLanes hi[3]) {
+		RocketMask out = (box.max[0] < lo[0]) | (box.min[0] > hi[0]);
+		for(int i = 1; i < 3; i++) out = out | (box.max[i] < lo[i]) | (box.min[i] > hi[i]);
+		return andNot(lo[0] == lo[0], out);
+	}
+
+	/// Simulation::checkCollision() of spheres centered at p
+	static RocketMask touches(const RocketLanes p[3], RocketLanes radius,
+							  const BoxLanes &box, RocketLanes point[3]) {
+		RocketLanes d[3];
+		clampToBox(p, box.min, box.max, point);
+		for(int i = 0; i < 3; i++) d[i] = point[i] - p[i];
+		return sqrt(dot3(d, d)) < radius;
+	}
+
+	/**
+	 * sweepSphere() on every lane, with a fixed number of steps
+	 * @param hit where the sphere touches the box, at the returned t
+	 */
+	static RocketLanes sweepLanes(const RocketLanes center[3], RocketLanes radius,
+								  const RocketLanes motion[3], const BoxLanes &box,
+								  RocketMask &hit) {
+		RocketLanes zero = rocketLanes(0.0f), one = rocketLanes(1.0f);
+		RocketLanes enter = zero, exit = one;
+		hit = zero == zero;
+		for(int i = 0; i < 3; i++) {
+			RocketLanes lo = box.min[i] - radius;
+			RocketLanes hi = box.max[i] + radius;
+			RocketMask still = motion[i] == zero;
+			hit = andNot(hit, still & ((center[i] < lo) | (center[i] > hi)));
+			RocketLanes a = (lo - center[i]) / motion[i];
+			RocketLanes b = (hi - center[i]) / motion[i];
+			enter = select(still, enter, max(enter, min(a, b)));
+			exit = select(still, exit, min(exit, max(a, b)));
+		}
+		hit = andNot(hit, enter > exit);
+		if(!any(hit)) return enter;
+
+		RocketLanes r2 = radius * radius;
+		RocketMask near = distance2(center, motion, box, enter) <= r2;
+		// Centers inside the box are left to the overlap test
+		RocketLanes inside[3], outward[3];
+		clampToBox(center, box.min, box.max, inside);
+		for(int i = 0; i < 3; i++) outward[i] = center[i] - inside[i];
+		RocketMask into = andNot(dot3(outward, motion) < zero,
+								 dot3(outward, outward) == zero);
+		RocketMask nearHit = near & ((enter > zero) | into);
+
+		RocketMask rounded = andNot(hit, near);
+		RocketLanes t = enter;
+		if(any(rounded)) {
+			// Ternary search of the closest approach, then bisection of
+			// the first contact before it
+			RocketLanes lo = enter, hi = exit, third = rocketLanes(3.0f);
+			RocketLanes half = rocketLanes(0.5f);
+			for(int i = 0; i < 32; i++) {
+				RocketLanes m1 = lo + (hi - lo) / third;
+				RocketLanes m2 = hi - (hi - lo) / third;
+				RocketMask left = distance2(center, motion, box, m1) <
+								  distance2(center, motion, box, m2);
+				hi = select(left, m2, hi);
+				lo = select(left, lo, m1);
+			}
+			hi = (lo + hi) * half;
+			rounded = andNot(rounded, distance2(center, motion, box, hi) > r2);
+
+			lo = enter;
+			for(int i = 0; i < 24; i++) {
+				RocketLanes mid = (lo + hi) * half;
+				RocketMask close = distance2(center, motion, box, mid) <= r2;
+				hi = select(close, mid, hi);
+				lo = select(close, lo, mid);
+			}
+			t = select(rounded, hi, t);
+		}
+		hit = hit & (nearHit | rounded);
+		return t;
+	}
+
+	/**
+	 * Simulation::resolveContact() with an OBJECT box, on the lanes of
+	 * mask
+	 */
+	void resolve(RocketMask mask, RocketLanes boxTop, const RocketLanes point[3],
+				 RocketLanes p[3], RocketLanes v[3], RocketLanes rest[3],
+				 RocketMask &isRest) const {
+		RocketLanes zero = rocketLanes(0.0f), half = rocketLanes(0.5f);
+		RocketLanes r = rocketLanes(radius);
+		RocketLanes difference[3], normal[3];
+		for(int i = 0; i < 3; i++) difference[i] = p[i] - point[i];
+		RocketLanes apart = dot3(difference, difference), moving = dot3(v, v);
+		RocketLanes inverse = rocketLanes(1.0f) / sqrt(apart);
+		RocketLanes back = rocketLanes(1.0f) / sqrt(moving);
+		for(int i = 0; i < 3; i++) {
+			RocketLanes up = rocketLanes(i == 1 ? 1.0f : 0.0f);
+			normal[i] = select(apart > zero, difference[i] * inverse,
+							   select(moving > zero, (zero - v[i]) * back, up));
+		}
+
+		for(int i = 0; i < 3; i++) p[i] = select(mask, point[i] + normal[i] * r, p[i]);
+		RocketLanes along = dot3(v, normal);
+		for(int i = 0; i < 3; i++) v[i] = select(mask, v[i] - normal[i] * along, v[i]);
+
+		// From above, not from the side nor from below
+		RocketMask side = (max(normal[0], zero - normal[0]) > half) |
+						  (max(normal[2], zero - normal[2]) > half);
+		RocketMask lands = andNot(mask & (p[1] <= boxTop + r), side);
+		lands = andNot(lands, normal[1] == rocketLanes(-1.0f));
+		isRest = isRest | lands;
+		rest[0] = select(lands, p[0], rest[0]);
+		rest[1] = select(lands, p[1] + rocketLanes(0.01f), rest[1]);
+		rest[2] = select(lands, p[2], rest[2]);
+		for(int i = 0; i < 3; i++) v[i] = select(lands, zero, v[i]);
+	}
+
+	/**
+	 * One tick of Simulation::tick() for the rockets from o on
+	 */
+	void stepLanes(size_t o) {
+		RocketLanes zero = rocketLanes(0.0f), one = rocketLanes(1.0f);
+		RocketLanes half = rocketLanes(0.5f), dt = rocketLanes(deltaT);
+		RocketLanes r = rocketLanes(radius);
+		const uint32_t *held = &keys[o];
+
+		RocketLanes p[3], v[3], rest[3], start[3];
+		for(int i = 0; i < 3; i++) {
+			p[i] = start[i] = loadLanes(&position[i][o]);
+			v[i] = loadLanes(&speed[i][o]);
+			rest[i] = loadLanes(&resting[i][o]);
+		}
+		RocketLanes rx = loadLanes(&rotationX[o]), ry = loadLanes(&rotationY[o]);
+		RocketLanes hor = loadLanes(&rotHor[o]), vert = loadLanes(&rotVert[o]);
+		RocketLanes vs = loadLanes(&verticalSpeed[o]);
+		RocketMask isRest = loadLanes(&isResting[o]) > half;
+		RocketMask right = loadLanes(&wasGoingRight[o]) > half;
+		RocketMask up = loadLanes(&wasGoingUp[o]) > half;
+		RocketLanes tiltStep = loadLanes(&tilt[o]), limit = loadLanes(&maxTilt[o]);
+
+		// getDirection()
+		RocketMask w = heldLanes(held, SimInput::W);
+		rx = select(w, rx - one, rx);
+		vert = select(w & up, max(vert - tiltStep, zero - limit), vert);
+		up = up | w;
+		RocketMask s = heldLanes(held, SimInput::S);
+		rx = select(s, rx + one, rx);
+		vert = select(andNot(s, up), min(vert + tiltStep, limit), vert);
+		up = andNot(up, s);
+		RocketMask a = heldLanes(held, SimInput::A);
+		ry = select(a, ry + one, ry);
+		hor = select(andNot(a, right), min(hor + tiltStep, limit), hor);
+		right = andNot(right, a);
+		RocketMask d = heldLanes(held, SimInput::D);
+		ry = select(d, ry - one, ry);
+		hor = select(d & right, max(hor - tiltStep, zero - limit), hor);
+		right = right | d;
+
+		// Stabilize
+		RocketLanes threshold = loadLanes(&stabilizeThreshold[o]);
+		RocketLanes back = loadLanes(&straighten[o]);
+		RocketMask tilted = (hor <= zero - threshold) | (hor >= threshold);
+		RocketLanes straight = hor + select(right, back, zero - back);
+		hor = select(tilted, min(max(straight, zero - limit), limit), hor);
+		tilted = (vert <= zero - threshold) | (vert >= threshold);
+		straight = vert + select(up, back, zero - back);
+		vert = select(tilted, min(max(straight, zero - limit), limit), vert);
+
+		// Gravity
+		RocketLanes fall = max(vs + loadLanes(&gravity[o]) * dt, rocketLanes(0.1f));
+		vs = select(isRest, vs, fall);
+
+		// Thrust along the rocket, capped
+		RocketMask space = heldLanes(held, SimInput::SPACE);
+		if(any(space)) {
+			float angle[2][ROCKET_LANES];
+			storeLanes(angle[0], rx);
+			storeLanes(angle[1], ry);
+			for(int k = 0; k < 2; k++) {
+				for(int l = 0; l < ROCKET_LANES; l++) turn(k, o + l, angle[k][l]);
+			}
+			RocketLanes sx = loadLanes(&sines[0][o]), cx = loadLanes(&cosines[0][o]);
+			RocketLanes sy = loadLanes(&sines[1][o]), cy = loadLanes(&cosines[1][o]);
+			// Column z of glm::rotate() about y then x, rounded as it is
+			RocketLanes direction[3] = {zero - sy * cx, (cy + (one - cy)) * sx,
+										zero - cy * cx};
+			RocketLanes thrust = loadLanes(&moveSpeed[o]);
+			RocketLanes pushed[3];
+			for(int i = 0; i < 3; i++) pushed[i] = v[i] + direction[i] * thrust * dt;
+			RocketLanes length = sqrt(dot3(pushed, pushed));
+			RocketLanes inverse = one / length;
+			for(int i = 0; i < 3; i++) {
+				pushed[i] = select(length > one, pushed[i] * inverse, pushed[i]);
+				v[i] = select(space, pushed[i], v[i]);
+			}
+			isRest = andNot(isRest, space);
+			vs = select(space, zero, vs);
+		}
+
+		// Boxes touched at the start of the tick
+		RocketLanes lo[3], hi[3];
+		for(int i = 0; i < 3; i++) {
+			lo[i] = start[i] - r;
+			hi[i] = start[i] + r;
+		}
+		for(int c : query(zero == zero, lo, hi)) {
+			BoxLanes box(boxes[c]);
+			RocketLanes point[3];
+			RocketMask contact = overlaps(box, lo, hi);
+			if(!any(contact)) continue;
+			contact = contact & touches(start, r, box, point);
+			if(!any(contact)) continue;
+			contact = contact & touches(p, r, box, point);
+			if(any(contact)) resolve(contact, box.max[1], point, p, v, rest, isRest);
+		}
+
+		for(int i = 0; i < 3; i++) p[i] = select(isRest, rest[i], p[i]);
+		v[1] = select(isRest, v[1], max(v[1] - vs, rocketLanes(-1.75f)));
+
+		// sweepRocket()
+		RocketLanes left = select(isRest, zero, dt);
+		RocketLanes skin = r + rocketLanes(contactSkin);
+		for(int step = 0; step < sweepSteps; step++) {
+			RocketMask moving = left > zero;
+			if(!any(moving)) break;
+
+			RocketLanes motion[3];
+			for(int i = 0; i < 3; i++) {
+				motion[i] = v[i] * left;
+				RocketLanes end = p[i] + motion[i];
+				lo[i] = min(p[i], end) - r;
+				hi[i] = max(p[i], end) + r;
+			}
+			RocketLanes tHit = one;
+			RocketMask hit = zero > zero;
+			RocketLanes hitMin[3], hitMax[3];
+			for(int i = 0; i < 3; i++) hitMin[i] = hitMax[i] = zero;
+			for(int c : query(moving, lo, hi)) {
+				BoxLanes box(boxes[c]);
+				RocketMask sooner = moving & overlaps(box, lo, hi);
+				if(!any(sooner)) continue;
+				RocketMask swept;
+				RocketLanes t = sweepLanes(p, r, motion, box, swept);
+				sooner = sooner & swept & (t < tHit);
+				if(!any(sooner)) continue;
+				tHit = select(sooner, t, tHit);
+				hit = hit | sooner;
+				for(int i = 0; i < 3; i++) {
+					hitMin[i] = select(sooner, box.min[i], hitMin[i]);
+					hitMax[i] = select(sooner, box.max[i], hitMax[i]);
+				}
+			}
+
+			for(int i = 0; i < 3; i++) p[i] = select(moving, p[i] + motion[i] * tHit, p[i]);
+			if(any(hit)) {
+				RocketLanes point[3], gap[3];
+				clampToBox(p, hitMin, hitMax, point);
+				for(int i = 0; i < 3; i++) gap[i] = point[i] - p[i];
+				RocketMask contact = hit & (sqrt(dot3(gap, gap)) < skin);
+				if(any(contact)) resolve(contact, hitMax[1], point, p, v, rest, isRest);
+			}
+			left = select(andNot(hit, isRest), left * (one - tHit), zero);
+		}
+
+		// Prevent crazy bugs
+		RocketMask lost = andNot(zero == zero, (p[0] == p[0]) & (p[1] == p[1]) &
+												   (p[2] == p[2]));
+		p[0] = select(lost, rocketLanes(-1.0f), p[0]);
+		p[1] = select(lost, rocketLanes(2.0f), p[1]);
+		p[2] = select(lost, rocketLanes(4.0f), p[2]);
+
+		for(int i = 0; i < 3; i++) {
+			storeLanes(&position[i][o], p[i]);
+			storeLanes(&speed[i][o], v[i]);
+			storeLanes(&resting[i][o], rest[i]);
+		}
+		storeLanes(&rotationX[o], rx);
+		storeLanes(&rotationY[o], ry);
+		storeLanes(&rotHor[o], hor);
+		storeLanes(&rotVert[o], vert);
+		storeLanes(&verticalSpeed[o], vs);
+		storeLanes(&isResting[o], select(isRest, one, zero));
+		storeLanes(&wasGoingRight[o], select(right, one, zero));
+		storeLanes(&wasGoingUp[o], select(up, one, zero));
+	}
+};
@@ -0,0 +1,900 @@
+// Scene files read into plain descriptions, and the transform hierarchy
+// of their instances: shared by the game and the headless simulation,
+// so nothing in here needs Vulkan (LayoutInterpreter maps the bindings);
+// include it after Assets.hpp
+
+#include <unordered_set>
+
+/**
+ * Local and world matrices of a set of nodes, each one relative to
+ * an optional parent. Nodes loaded from a scene are stored parents
+ * first, and only the subtrees of nodes whose local matrix changed
+ * are recomputed.
+ */
+class TransformHierarchy {
+public:
+	/**
+	 * Add a node
+	 * @param parent an existing node, or -1 for a root
+	 * @param node a slot freed by remove() to reuse, or -1 to append
+	 * @return the index of the node
+	 */
+	int add(int parent, const glm::mat4 &local, int node = -1) {
+		if(node < 0) {
+			node = parents.size();
+			parents.push_back(-1);
+			firstChild.push_back(-1);
+			nextSibling.push_back(-1);
+			locals.emplace_back();
+			worlds.emplace_back();
+			stamps.push_back(0);
+			alive.push_back(false);
+		} else if(alive[node]) {
+			throw std::runtime_error("transform node is still in use");
+		}
+		if(parent >= (int)parents.size() || (parent >= 0 && !alive[parent])) {
+			throw std::runtime_error("transform parent must be added before its children");
+		}
+
+		parents[node] = parent;
+		firstChild[node] = -1;
+		nextSibling[node] = -1;
+		if(parent >= 0) {
+			nextSibling[node] = firstChild[parent];
+			firstChild[parent] = node;
+		}
+		locals[node] = local;
+		worlds[node] = parent >= 0 ? worlds[parent] * local : local;
+		alive[node] = true;
+		return node;
+	}
+
+	/// Free a node without children, its slot can be given back to add()
+	void remove(int node) {
+		if(firstChild[node] >= 0) {
+			throw std::runtime_error("transform node removed before its children");
+		}
+
+		int p = parents[node];
+		if(p >= 0) {
+			int *link = &firstChild[p];
+			while(*link != node) link = &nextSibling[*link];
+			*link = nextSibling[node];
+		}
+		parents[node] = -1;
+		nextSibling[node] = -1;
+		alive[node] = false;
+	}
+
+	/// node and all its descendants, every parent before its children
+	std::vector<int> subtree(int node) const {
+		std::vector<int> nodes{node};
+		for(size_t i = 0; i < nodes.size(); i++) {
+			for(int c = firstChild[nodes[i]]; c >= 0; c = nextSibling[c]) {
+				nodes.push_back(c);
+			}
+		}
+		return nodes;
+	}
+
+	void setLocal(int node, const glm::mat4 &local) {
+		locals[node] = local;
+		dirty.push_back(node);
+	}
+
+	const glm::mat4 &local(int node) const { return locals[node]; }
+	const glm::mat4 &world(int node) const { return worlds[node]; }
+	int parent(int node) const { return parents[node]; }
+	int size() const { return parents.size(); }
+
+	/**
+	 * Recompute the world matrices below every node moved since the
+	 * last update, calling changed(node) for each of them
+	 */
+	template<class F>
+	void update(F &&changed) {
+		if(dirty.empty()) return;
+
+		// Scene nodes have their ancestors first, so a dirty node inside
+		// a subtree already refreshed in this pass is usually skipped;
+		// otherwise it is just refreshed twice
+		std::sort(dirty.begin(), dirty.end());
+		pass++;
+		for(int root : dirty) {
+			if(stamps[root] == pass || !alive[root]) continue;
+
+			stack.push_back(root);
+			while(!stack.empty()) {
+				int node = stack.back();
+				stack.pop_back();
+
+				int p = parents[node];
+				worlds[node] = p >= 0 ? worlds[p] * locals[node] : locals[node];
+				stamps[node] = pass;
+				changed(node);
+
+				for(int c = firstChild[node]; c >= 0; c = nextSibling[c]) {
+					stack.push_back(c);
+				}
+			}
+		}
+		dirty.clear();
+	}
+
+private:
+	std::vector<int> parents;
+	std::vector<int> firstChild;
+	std::vector<int> nextSibling;
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> worlds;
+
+	std::vector<int> dirty;
+	std::vector<int> stack;
+	/// Last update pass that refreshed each node
+	std::vector<uint32_t> stamps;
+	uint32_t pass = 0;
+	std::vector<bool> alive;
+};
+
+/// Kinds of descriptors and shader stages a scene layout may bind
+enum BindingType { UBO_BINDING, IMAGE_BINDING };
+enum BindingStage { VERTEX_STAGE, FRAGMENT_STAGE, ALL_STAGES };
+
+/// Plain record, stored as is in compiled scene files
+struct BindingDescription {
+	uint32_t binding;
+	BindingType type;
+	BindingStage stage;
+};
+
+/**
+ * Binding of a scene layout from its recipe directives
+ * @param i binding index
+ * @param type "ubo" or "img"
+ * @param stage "vert", "frag" or anything else for all stages
+ */
+BindingDescription bindingFromStrings(int i, const std::string &type, const std::string &stage) {
+	BindingDescription res{};
+	res.binding = i;
+
+	if(type == "ubo") {
+		res.type = UBO_BINDING;
+	} else if(type == "img") {
+		res.type = IMAGE_BINDING;
+	} else {
+		throw std::runtime_error("unknown binding type: " + type);
+	}
+
+	if(stage == "vert") {
+		res.stage = VERTEX_STAGE;
+	} else if(stage == "frag") {
+		res.stage = FRAGMENT_STAGE;
+	} else {
+		res.stage = ALL_STAGES;
+	}
+
+	return res;
+}
+
+struct LayoutDescription {
+	std::string name;
+	std::vector<BindingDescription> bindings;
+	/// Number of "img" bindings
+	int textures;
+};
+
+struct PipelineDescription {
+	std::string name;
+	std::string vert;
+	std::string frag;
+	int layout;
+};
+
+struct ModelDescription {
+	std::string id;
+	std::string file;
+	ModelType format;
+};
+
+struct TextureDescription {
+	std::string id;
+	std::string file;
+	TextureSemantic semantic;
+};
+
+/// Plain record, stored as is in compiled scene files
+struct InstanceDescription {
+	glm::mat4 Wm;	// relative to the parent, if any
+	uint32_t id;	// offset of the name in SceneDescription::names
+	int32_t model;
+	int32_t texture;
+	int32_t layout;
+	int32_t pipeline;
+	int32_t parent;	// always a previous instance, -1 for none
+	uint32_t padding[2];
+};
+
+/**
+ * Contents of a scene file, with every name reference resolved
+ * to an index and every instance transform already evaluated.
+ * Instances are sorted so that parents come before their children.
+ */
+struct SceneDescription {
+	std::vector<LayoutDescription> layouts;
+	std::vector<PipelineDescription> pipelines;
+	std::vector<ModelDescription> models;
+	std::vector<TextureDescription> textures;
+	std::vector<InstanceDescription> instances;
+	/// NUL terminated instance names
+	std::vector<char> names;
+
+	const char *name(uint32_t offset) const { return names.data() + offset; }
+
+	uint32_t addName(const std::string &name) {
+		uint32_t offset = names.size();
+		names.insert(names.end(), name.c_str(), name.c_str() + name.size() + 1);
+		return offset;
+	}
+};
+
+/// Bump whenever the compiled scene layout changes
+const uint32_t SCENE_CACHE_VERSION = 3;
+
+/**
+ * Header of a compiled scene, followed by the source path, the
+ * instances, the layouts, their bindings, the pipelines, the models,
+ * the textures and the string pool. Strings are offsets in the pool.
+ */
+struct SceneCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceTime;	// 0 for a scene compiled on its own
+	uint64_t sourceSize;
+	uint32_t pathLength;
+	uint32_t instanceCount;
+	uint32_t layoutCount;
+	uint32_t bindingCount;
+	uint32_t pipelineCount;
+	uint32_t modelCount;
+	uint32_t textureCount;
+	uint32_t stringsSize;
+};
+
+struct SceneCacheLayout {
+	uint32_t name;
+	uint32_t firstBinding;
+	uint32_t bindingCount;
+	int32_t textures;
+};
+
+struct SceneCachePipeline {
+	uint32_t name;
+	uint32_t vert;
+	uint32_t frag;
+	int32_t layout;
+};
+
+/// A model or a texture
+struct SceneCacheAsset {
+	uint32_t id;
+	uint32_t file;
+	uint32_t type;	// ModelType or TextureSemantic
+};
+
+std::string sceneCachePath(const std::string &file) {
+	std::string name = file;
+	for(char &c : name) {
+		if(c == '/' || c == '\\' || c == ':') c = '_';
+	}
+	return std::string(ASSET_CACHE_DIR) + "/" + name + ".scnc";
+}
+
+/**
+ * Builds a SceneDescription straight from the tokens of a scene.json
+ * file, without an intermediate nlohmann::json tree: instances are
+ * completed, with their world matrix, as soon as their object closes.
+ * Names are given an index when first seen, so sections may come in
+ * any order; finish() checks that every referenced name was defined.
+ */
+class SceneSaxHandler : public nlohmann::json_sax<nlohmann::json> {
+public:
+	SceneDescription scene;
+	/// Top level keys seen
+	int sections = 0;
+	std::string error;
+
+	bool null() override { return true; }
+	bool boolean(bool /*val*/) override { return true; }
+	bool binary(binary_t &/*val*/) override { return true; }
+	bool number_integer(number_integer_t val) override { return number(val); }
+	bool number_unsigned(number_unsigned_t val) override { return number(val); }
+	bool number_float(number_float_t val, const string_t &/*s*/) override {
+		return number(val);
+	}
+
+	bool string(string_t &val) override {
+		if(depth == 3) {
+			recordField(val);
+		} else if(depth == 5) {
+			if(subField == "type") subType = val;
+			else if(subField == "stage") subStage = val;
+		}
+		return true;
+	}
+
+	bool key(string_t &val) override {
+		if(depth == 1) {
+			sections++;
+			section = sectionFromString(val);
+		} else if(depth == 3) {
+			field = val;
+		} else if(depth == 5) {
+			subField = val;
+		}
+		return true;
+	}
+
+	bool start_object(std::size_t /*elements*/) override {
+		depth++;
+		if(depth == 3) {
+			startRecord();
+		} else if(depth == 5) {
+			subField.clear();
+			subType.clear();
+			subStage.clear();
+			vec = glm::vec3(0.0f);
+		}
+		return true;
+	}
+
+	bool end_object() override {
+		if(depth == 3) {
+			endRecord();
+		} else if(depth == 5) {
+			endSubRecord();
+		}
+		depth--;
+		return true;
+	}
+
+	bool start_array(std::size_t /*elements*/) override {
+		depth++;
+		vecIndex = 0;
+		return true;
+	}
+
+	bool end_array() override {
+		depth--;
+		return true;
+	}
+
+	bool parse_error(std::size_t /*position*/, const std::string &/*last_token*/,
+					 const nlohmann::detail::exception &ex) override {
+		error = ex.what();
+		return false;
+	}
+
+	/**
+	 * Check that every name referenced by the scene has been defined,
+	 * and put parents before their children
+	 */
+	void finish() {
+		check(layoutIds, "layout");
+		check(pipelineIds, "pipeline");
+		check(modelIds, "model");
+		check(textureIds, "texture");
+
+		for(auto &pending : pendingParents) {
+			auto it = instanceIds.find(pending.second);
+			if(it == instanceIds.end()) {
+				throw std::runtime_error("scene references unknown instance: " +
+										 pending.second);
+			}
+			scene.instances[pending.first].parent = it->second;
+		}
+		pendingParents.clear();
+
+		sortInstances();
+	}
+
+private:
+	enum Section { OTHER, LAYOUTS, PIPELINES, MODELS, TEXTURES, INSTANCES };
+
+	struct NameTable {
+		std::unordered_map<std::string, int> ids;
+		std::vector<bool> defined;
+	};
+
+	/// Open objects and arrays: 1 is the root, 3 a record of a section,
+	/// 5 a binding of a layout or a transformation of an instance
+	int depth = 0;
+	Section section = OTHER;
+	std::string field;
+	std::string subField;
+
+	/// Record being read
+	std::string name, vert, frag, file, format, semantic, parentName;
+	int layout;
+	InstanceDescription instance;
+	std::vector<BindingDescription> bindings;
+	int textures;
+
+	/// Binding or transformation being read
+	std::string subType, subStage;
+	glm::vec3 vec;
+	int vecIndex;
+
+	NameTable layoutIds, pipelineIds, modelIds, textureIds;
+
+	std::unordered_map<std::string, int> instanceIds;
+	/// <instance, parent> for parents defined after their children
+	std::vector<std::pair<int, std::string>> pendingParents;
+
+	/// Reorder the instances so that parents come before their children
+	void sortInstances() {
+		auto &instances = scene.instances;
+		int n = instances.size();
+
+		// Depth of every instance, following parents iteratively
+		std::vector<int> depth(n, -1);
+		std::vector<int> chain;
+		for(int i = 0; i < n; i++) {
+			int k = i;
+			while(k >= 0 && depth[k] < 0) {
+				if(chain.size() > (size_t)n) {
+					throw std::runtime_error(std::string("instance ") +
+											 scene.name(instances[i].id) +
+											 " is its own ancestor");
+				}
+				chain.push_back(k);
+				k = instances[k].parent;
+			}
+			int d = k >= 0 ? depth[k] : -1;
+			while(!chain.empty()) {
+				depth[chain.back()] = ++d;
+				chain.pop_back();
+			}
+		}
+
+		std::vector<int> order(n);
+		for(int i = 0; i < n; i++) order[i] = i;
+		std::stable_sort(order.begin(), order.end(),
+						 [&depth](int a, int b) { return depth[a] < depth[b]; });
+
+		std::vector<int> newIndex(n);
+		std::vector<InstanceDescription> sorted(n);
+		for(int i = 0; i < n; i++) {
+			newIndex[order[i]] = i;
+		}
+		for(int i = 0; i < n; i++) {
+			sorted[i] = instances[order[i]];
+			if(sorted[i].parent >= 0) sorted[i].parent = newIndex[sorted[i].parent];
+		}
+		instances = std::move(sorted);
+	}
+
+	static Section sectionFromString(const std::string &s) {
+		if(s == "layouts") return LAYOUTS;
+		if(s == "pipelines") return PIPELINES;
+		if(s == "models") return MODELS;
+		if(s == "textures") return TEXTURES;
+		if(s == "instances") return INSTANCES;
+		return OTHER;
+	}
+
+	bool number(float val) {
+		if(depth == 6 && section == INSTANCES && field == "transforms" &&
+		   subField == "vec" && vecIndex < 3) {
+			vec[vecIndex++] = val;
+		}
+		return true;
+	}
+
+	/// Index of name, reserving a slot in items if it is new
+	template<class T>
+	static int intern(NameTable &table, std::vector<T> &items, const std::string &name) {
+		auto it = table.ids.find(name);
+		if(it != table.ids.end()) return it->second;
+
+		int id = items.size();
+		table.ids[name] = id;
+		table.defined.push_back(false);
+		items.emplace_back();
+		return id;
+	}
+
+	template<class T>
+	static T &define(NameTable &table, std::vector<T> &items, const std::string &name) {
+		int id = intern(table, items, name);
+		if(table.defined[id]) {
+			std::cout << "WARNING: " << name << " is defined twice in the scene\n";
+		}
+		table.defined[id] = true;
+		return items[id];
+	}
+
+	static void check(const NameTable &table, const char *kind) {
+		for(auto &id : table.ids) {
+			if(!table.defined[id.second]) {
+				throw std::runtime_error(std::string("scene references unknown ") +
+										 kind + ": " + id.first);
+			}
+		}
+	}
+
+	void startRecord() {
+		field.clear();
+		name.clear();
+		vert.clear();
+		frag.clear();
+		file.clear();
+		format.clear();
+		parentName.clear();
+		semantic = "albedo";
+		layout = -1;
+		instance = InstanceDescription{};
+		instance.Wm = glm::mat4(1.0f);
+		instance.model = instance.texture = instance.layout = instance.pipeline = -1;
+		instance.parent = -1;
+		bindings.clear();
+		textures = 0;
+	}
+
+	void recordField(const std::string &val) {
+		if(field == "id" || field == "name") {
+			name = val;
+		} else if(section == PIPELINES) {
+			if(field == "vert") vert = val;
+			else if(field == "frag") frag = val;
+			else if(field == "layout") layout = intern(layoutIds, scene.layouts, val);
+		} else if(section == MODELS) {
+			if(field == "model") file = val;
+			else if(field == "format") format = val;
+		} else if(section == TEXTURES) {
+			if(field == "texture") file = val;
+			else if(field == "semantic") semantic = val;
+		} else if(section == INSTANCES) {
+			if(field == "model")
+				instance.model = intern(modelIds, scene.models, val);
+			else if(field == "texture")
+				instance.texture = intern(textureIds, scene.textures, val);
+			else if(field == "layout")
+				instance.layout = intern(layoutIds, scene.layouts, val);
+			else if(field == "pipeline")
+				instance.pipeline = intern(pipelineIds, scene.pipelines, val);
+			else if(field == "parent")
+				parentName = val;
+		}
+	}
+
+	void endSubRecord() {
+		if(section == LAYOUTS && field == "bindings") {
+			bindings.push_back(bindingFromStrings(bindings.size(), subType, subStage));
+			if(subType == "img") textures++;
+		} else if(section == INSTANCES && field == "transforms") {
+			TransformInterpreter::apply(instance.Wm,
+										TransformInterpreter::typeFromString(subType),
+										vec);
+		}
+	}
+
+	void endRecord() {
+		switch(section) {
+		case LAYOUTS: {
+			LayoutDescription &L = define(layoutIds, scene.layouts, name);
+			L.name = name;
+			L.bindings = std::move(bindings);
+			L.textures = textures;
+			break;
+		}
+		case PIPELINES: {
+			if(layout < 0) throw std::runtime_error("pipeline " + name + " has no layout");
+			PipelineDescription &P = define(pipelineIds, scene.pipelines, name);
+			P = {name, vert, frag, layout};
+			break;
+		}
+		case MODELS: {
+			ModelDescription &M = define(modelIds, scene.models, name);
+			M = {name, file, modelTypeFromString(format)};
+			break;
+		}
+		case TEXTURES: {
+			TextureDescription &T = define(textureIds, scene.textures, name);
+			T = {name, file, textureSemanticFromString(semantic)};
+			break;
+		}
+		case INSTANCES:
+			if(instance.model < 0 || instance.texture < 0 || instance.layout < 0 ||
+			   instance.pipeline < 0) {
+				throw std::runtime_error("instance " + name + " is incomplete");
+			}
+			instance.id = scene.addName(name);
+			if(!parentName.empty()) {
+				auto it = instanceIds.find(parentName);
+				if(it != instanceIds.end()) {
+					instance.parent = it->second;
+				} else {
+					pendingParents.push_back({(int)scene.instances.size(), parentName});
+				}
+			}
+			instanceIds[name] = scene.instances.size();
+			scene.instances.push_back(instance);
+			break;
+		default:
+			break;
+		}
+	}
+};
+
+class SceneInterpreter {
+public:
+	/**
+	 * Parse a scene file
+	 * @param file path of the scene.json file
+	 * @return the scene description
+	 */
+	static SceneDescription parse(const std::string &file) {
+		SceneDescription scene;
+		if(loadCompiled(file, scene)) return scene;
+
+		scene = parseJSON(file);
+
+		std::error_code ec;
+		auto sourceTime = std::filesystem::last_write_time(file, ec);
+		if(ec) return scene;
+		auto sourceSize = std::filesystem::file_size(file, ec);
+		if(ec) return scene;
+
+		std::filesystem::create_directories(ASSET_CACHE_DIR, ec);
+		compile(scene, sceneCachePath(file), file,
+				(uint64_t)sourceTime.time_since_epoch().count(), sourceSize);
+		return scene;
+	}
+
+	/**
+	 * Parse a scene.json file, without looking at the compiled cache
+	 * @param file path of the scene.json file
+	 * @return the scene description
+	 */
+	static SceneDescription parseJSON(const std::string &file) {
+		MappedFile mapped;
+		if(!mapped.open(file)) {
+			throw std::runtime_error("Error! Scene file not found: " + file);
+		}
+
+		std::cout << "Parsing JSON\n";
+		SceneSaxHandler handler;
+		if(!nlohmann::json::sax_parse(mapped.data, mapped.data + mapped.size,
+									  &handler)) {
+			throw std::runtime_error(handler.error);
+		}
+		std::cout << "\n\n\nScene contains " << handler.sections
+				  << " definitions sections\n\n\n";
+
+		handler.finish();
+		return std::move(handler.scene);
+	}
+
+	/**
+	 * Write a compiled scene, which can be passed to SceneManager
+	 * in place of the JSON file
+	 * @param out path of the compiled file
+	 * @param source path, time and size of the file it was compiled
+	 * from, checked when it is used as a cache of that file
+	 */
+	static bool compile(const SceneDescription &scene, const std::string &out,
+						const std::string &source = "", uint64_t sourceTime = 0,
+						uint64_t sourceSize = 0) {
+		// Instance names come first so their offsets stay valid
+		std::vector<char> strings = scene.names;
+		auto addString = [&strings](const std::string &str) {
+			uint32_t offset = strings.size();
+			strings.insert(strings.end(), str.c_str(), str.c_str() + str.size() + 1);
+			return offset;
+		};
+
+		std::vector<SceneCacheLayout> layouts;
+		std::vector<BindingDescription> bindings;
+		for(auto &L : scene.layouts) {
+			layouts.push_back({addString(L.name), (uint32_t)bindings.size(),
+							   (uint32_t)L.bindings.size(), L.textures});
+			bindings.insert(bindings.end(), L.bindings.begin(), L.bindings.end());
+		}
+
+		std::vector<SceneCachePipeline> pipelines;
+		for(auto &P : scene.pipelines) {
+			pipelines.push_back({addString(P.name), addString(P.vert),
+								 addString(P.frag), P.layout});
+		}
+
+		std::vector<SceneCacheAsset> models, textures;
+		for(auto &M : scene.models) {
+			models.push_back({addString(M.id), addString(M.file), (uint32_t)M.format});
+		}
+		for(auto &T : scene.textures) {
+			textures.push_back({addString(T.id), addString(T.file), (uint32_t)T.semantic});
+		}
+
+		SceneCacheHeader header{};
+		memcpy(header.magic, "SCNC", 4);
+		header.version = SCENE_CACHE_VERSION;
+		header.sourceTime = sourceTime;
+		header.sourceSize = sourceSize;
+		header.pathLength = source.size();
+		header.instanceCount = scene.instances.size();
+		header.layoutCount = layouts.size();
+		header.bindingCount = bindings.size();
+		header.pipelineCount = pipelines.size();
+		header.modelCount = models.size();
+		header.textureCount = textures.size();
+		header.stringsSize = strings.size();
+
+		// Write aside and rename, so that a concurrent run never maps half a file
+		std::string tmpFile = out + ".tmp";
+		std::ofstream os(tmpFile, std::ios::binary | std::ios::trunc);
+		if(!os.is_open()) {
+			std::cout << "Warning: cannot write " << tmpFile << "\n";
+			return false;
+		}
+
+		auto write = [&os](const auto &v) {
+			os.write(reinterpret_cast<const char *>(v.data()),
+					 v.size() * sizeof(v[0]));
+		};
+		os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		os.write(source.data(), source.size());
+		write(scene.instances);
+		write(layouts);
+		write(bindings);
+		write(pipelines);
+		write(models);
+		write(textures);
+		write(strings);
+		os.close();
+
+		std::error_code ec;
+		if(!os) {
+			std::cout << "Warning: cannot write " << tmpFile << "\n";
+			std::filesystem::remove(tmpFile, ec);
+			return false;
+		}
+
+		std::filesystem::rename(tmpFile, out, ec);
+		if(ec) {
+			std::filesystem::remove(tmpFile, ec);
+			return false;
+		}
+		return true;
+	}
+
+private:
+	/**
+	 * Load file if it is a compiled scene, or the compiled cache of
+	 * file if it is up to date. The instances are copied as they are.
+	 */
+	static bool loadCompiled(const std::string &file, SceneDescription &out) {
+		// Filled in here and only handed out once every check passed
+		SceneDescription scene;
+		MappedFile mapped;
+		if(!mapped.open(file)) return false;
+
+		bool compiled = mapped.size >= 4 && memcmp(mapped.data, "SCNC", 4) == 0;
+		std::string source;
+		uint64_t sourceTime = 0, sourceSize = 0;
+		if(!compiled) {
+			std::error_code ec;
+			auto time = std::filesystem::last_write_time(file, ec);
+			if(ec) return false;
+			sourceSize = std::filesystem::file_size(file, ec);
+			if(ec) return false;
+			sourceTime = (uint64_t)time.time_since_epoch().count();
+			source = file;
+
+			if(!mapped.open(sceneCachePath(file))) return false;
+		}
+
+		SceneCacheHeader header;
+		if(mapped.size < sizeof(header)) return false;
+		memcpy(&header, mapped.data, sizeof(header));
+
+		if(memcmp(header.magic, "SCNC", 4) != 0 ||
+		   header.version != SCENE_CACHE_VERSION) {
+			if(compiled) std::cout << "Warning: " << file << " has an old format\n";
+			return false;
+		}
+		if(!compiled && (header.sourceTime != sourceTime ||
+						 header.sourceSize != sourceSize ||
+						 header.pathLength != source.size())) {
+			return false;
+		}
+
+		size_t expected = sizeof(header) + header.pathLength +
+						  header.instanceCount * sizeof(InstanceDescription) +
+						  header.layoutCount * sizeof(SceneCacheLayout) +
+						  header.bindingCount * sizeof(BindingDescription) +
+						  header.pipelineCount * sizeof(SceneCachePipeline) +
+						  ((size_t)header.modelCount + header.textureCount) *
+							  sizeof(SceneCacheAsset) +
+						  header.stringsSize;
+		if(mapped.size != expected || header.stringsSize == 0) return false;
+
+		const char *ptr = mapped.data + sizeof(header);
+		if(source.compare(0, source.size(), ptr, header.pathLength) != 0) return false;
+		ptr += header.pathLength;
+
+		auto read = [&ptr](auto &v, uint32_t count) {
+			v.resize(count);
+			memcpy(v.data(), ptr, count * sizeof(v[0]));
+			ptr += count * sizeof(v[0]);
+		};
+		std::vector<SceneCacheLayout> layouts;
+		std::vector<BindingDescription> bindings;
+		std::vector<SceneCachePipeline> pipelines;
+		std::vector<SceneCacheAsset> models, textures;
+		read(scene.instances, header.instanceCount);
+		read(layouts, header.layoutCount);
+		read(bindings, header.bindingCount);
+		read(pipelines, header.pipelineCount);
+		read(models, header.modelCount);
+		read(textures, header.textureCount);
+		read(scene.names, header.stringsSize);
+
+		if(scene.names.back() != '\0') return false;
+		auto str = [&scene](uint32_t offset) -> std::string {
+			if(offset >= scene.names.size()) throw std::runtime_error("corrupted compiled scene");
+			return scene.name(offset);
+		};
+
+		try {
+			for(auto &L : layouts) {
+				if(L.firstBinding > bindings.size() ||
+				   L.bindingCount > bindings.size() - L.firstBinding) {
+					return false;
+				}
+				for(size_t b = L.firstBinding; b < (size_t)L.firstBinding + L.bindingCount; b++) {
+					if((uint32_t)bindings[b].type > IMAGE_BINDING ||
+					   (uint32_t)bindings[b].stage > ALL_STAGES) {
+						throw std::runtime_error("unknown binding");
+					}
+				}
+				scene.layouts.push_back(
+					{str(L.name),
+					 {bindings.begin() + L.firstBinding,
+					  bindings.begin() + L.firstBinding + L.bindingCount},
+					 L.textures});
+			}
+			for(auto &P : pipelines) {
+				if(P.layout < 0 || P.layout >= (int)layouts.size()) return false;
+				scene.pipelines.push_back({str(P.name), str(P.vert), str(P.frag), P.layout});
+			}
+			for(auto &M : models) {
+				if(M.type > MGCG) throw std::runtime_error("unknown model type");
+				scene.models.push_back({str(M.id), str(M.file), (ModelType)M.type});
+			}
+			for(auto &T : textures) {
+				if(T.type > MASK) throw std::runtime_error("unknown texture semantic");
+				scene.textures.push_back({str(T.id), str(T.file), (TextureSemantic)T.type});
+			}
+		} catch(const std::runtime_error &) {
+			return false;
+		}
+
+		// Guard against a corrupted file, the records themselves are not parsed
+		for(int k = 0; k < (int)scene.instances.size(); k++) {
+			const InstanceDescription &I = scene.instances[k];
+			if(I.id >= header.stringsSize || I.parent < -1 || I.parent >= k ||
+			   I.model < 0 ||
+			   I.model >= (int)header.modelCount || I.texture < 0 ||
+			   I.texture >= (int)header.textureCount || I.layout < 0 ||
+			   I.layout >= (int)header.layoutCount || I.pipeline < 0 ||
+			   I.pipeline >= (int)header.pipelineCount) {
+				return false;
+			}
+		}
+
+		std::cout << "Loading : " << file << "[COMPILED] Instances: "
+				  << scene.instances.size() << "\n";
+		out = std::move(scene);
+		return true;
+	}
+};
@@ -1,7 +1,5 @@
 #include "Starter.hpp"
-#include <json.hpp>
-#include <glm/glm.hpp>
-#include <glm/ext/matrix_transform.hpp>
+#include "Scene.hpp"
 
 typedef struct {
 	std::string *id;
@@ -13,85 +11,130 @@ typedef struct {
 	glm::mat4 Wm;
 } Instance;
 
-class TransformInterpreter {
+/// Vulkan side of the layouts of a scene description
+class LayoutInterpreter {
 public:
+	/// Vulkan descriptor type and stages of one binding
+	static DescriptorSetLayoutBinding getBinding(const BindingDescription &B) {
+		DescriptorSetLayoutBinding res{};
+		res.binding = B.binding;
+		res.type = B.type == IMAGE_BINDING ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+										   : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+		if(B.stage == VERTEX_STAGE) {
+			res.flags = VK_SHADER_STAGE_VERTEX_BIT;
+		} else if(B.stage == FRAGMENT_STAGE) {
+			res.flags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		} else {
+			res.flags = VK_SHADER_STAGE_ALL_GRAPHICS;
+		}
+
+		return res;
+	}
+
 	/**
-	 * Compute world matrix from a list of transformations
-	 * @param transforms array of transformation objects (assumed to be valid)
-	 * @return the world matrix
+	 * Build DSLs from a layout of the scene
+	 * @param bindings the bindings of the layout, in order
+	 * @return array of DSLs
 	 */
-	static glm::mat4 computeWorld(nlohmann::json transforms) {
-		glm::mat4 Wm = glm::mat4(1.0f);
-		int numTrans = transforms.size();
-
-		for(int i = 0; i < numTrans; i++) {
-			nlohmann::json trans = transforms[i];
-
-			if(trans["type"] == "translate") {
-				float tx = trans["vec"][0];
-				float ty = trans["vec"][1];
-				float tz = trans["vec"][2];
-
-				Wm *= glm::translate(glm::mat4(1.0f), glm::vec3(tx, ty, tz));
-			} else if(trans["type"] == "rotate") {
-				float rx = trans["vec"][0];
-				float ry = trans["vec"][1];
-				float rz = trans["vec"][2];
-
-				if(rx != 0.0f)
-					Wm *= glm::rotate(glm::mat4(1.0f), glm::radians(rx),
-									  glm::vec3(1.0f, 0.0f, 0.0f));
-				if(ry != 0.0f)
-					Wm *= glm::rotate(glm::mat4(1.0f), glm::radians(ry),
-									  glm::vec3(0.0f, 1.0f, 0.0f));
-				if(rz != 0.0f)
-					Wm *= glm::rotate(glm::mat4(1.0f), glm::radians(rz),
-									  glm::vec3(0.0f, 0.0f, 1.0f));
-			} else if(trans["type"] == "scale") {
-				float sx = trans["vec"][0];
-				float sy = trans["vec"][1];
-				float sz = trans["vec"][2];
-
-				Wm *= glm::scale(glm::mat4(1.0f), glm::vec3(sx, sy, sz));
-			}
+	static std::vector<DescriptorSetLayoutBinding> getBindings(
+		const std::vector<BindingDescription> &bindings) {
+		std::vector<DescriptorSetLayoutBinding> res;
+
+		for(auto &binding : bindings) {
+			res.push_back(getBinding(binding));
 		}
 
-		return Wm;
+		return res;
 	}
 };
 
-class LayoutInterpreter {
+/**
+ * Reference counted models and textures shared by the scene and the
+ * application. Assets are keyed on their normalized path and on what
+ * changes the decoded data (vertex layout or texel format), so a file
+ * referenced several times is decoded and uploaded only once. An asset
+ * is destroyed when its last handle is released.
+ */
+template<class Vert>
+class AssetRegistry {
 public:
+	using ModelHandle = std::shared_ptr<Model<Vert>>;
+	using TextureHandle = std::shared_ptr<Texture>;
+
 	/**
-	 * Build DSLs from recipe directives
-	 * @param bindings json array describing bindings
-	 * @return array of DSLs
+	 * Get a handle to the model in file, starting its decoding on the
+	 * loader threads if no one holds it yet
 	 */
-	static std::vector<DescriptorSetLayoutBinding> getBindings(nlohmann::json bindings) {
-		int numBindings = bindings.size();
-		std::vector<DescriptorSetLayoutBinding> res(numBindings);
+	ModelHandle model(VertexDescriptor *VD, const std::string &file, ModelType MT) {
+		std::string key = assetKey(file, VD->layoutHash());
 
-		for(int i = 0; i < numBindings; i++) {
-			nlohmann::json binding = bindings[i];
+		auto it = models.find(key);
+		if(it != models.end()) {
+			if(ModelHandle m = it->second.lock()) return m;
+		}
 
-			res[i].binding = i;
+		Model<Vert> *raw = new Model<Vert>();
+		raw->BP = nullptr;
+		ModelHandle m(raw, [](Model<Vert> *m) {
+			if(m->BP != nullptr) m->cleanup();
+			delete m;
+		});
+		m->loadAsync(VD, file, MT);
+
+		models[key] = m;
+		pendingModels.push_back(m);
+		return m;
+	}
 
-			if(binding["type"] == "ubo") {
-				res[i].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			} else if(binding["type"] == "img") {
-				res[i].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			}
+	/// Get a handle to the texture in file, decoded for sem
+	TextureHandle texture(const std::string &file, TextureSemantic sem) {
+		std::string key = assetKey(file, textureSemanticFormat(sem));
 
-			if(binding["stage"] == "vert") {
-				res[i].flags = VK_SHADER_STAGE_VERTEX_BIT;
-			} else if(binding["stage"] == "frag") {
-				res[i].flags = VK_SHADER_STAGE_FRAGMENT_BIT;
-			} else {
-				res[i].flags = VK_SHADER_STAGE_ALL_GRAPHICS;
-			}
+		auto it = textures.find(key);
+		if(it != textures.end()) {
+			if(TextureHandle t = it->second.lock()) return t;
 		}
 
-		return res;
+		Texture *raw = new Texture();
+		raw->BP = nullptr;
+		TextureHandle t(raw, [](Texture *t) {
+			if(t->BP != nullptr) t->cleanup();
+			delete t;
+		});
+		t->loadAsync(file.c_str(), sem);
+
+		textures[key] = t;
+		pendingTextures.push_back(t);
+		return t;
+	}
+
+	/**
+	 * Create the buffers and images of every asset acquired since the
+	 * last call, waiting for their decoding to finish
+	 */
+	void initLoaded(BaseProject *BP) {
+		for(auto &m : pendingModels) {
+			m->initLoaded(BP);
+		}
+		for(auto &t : pendingTextures) {
+			t->initLoaded(BP);
+		}
+		pendingModels.clear();
+		pendingTextures.clear();
+	}
+
+private:
+	std::unordered_map<std::string, std::weak_ptr<Model<Vert>>> models;
+	std::unordered_map<std::string, std::weak_ptr<Texture>> textures;
+
+	/// Assets still decoding, kept alive until initLoaded() uploads them
+	std::vector<ModelHandle> pendingModels;
+	std::vector<TextureHandle> pendingTextures;
+
+	static std::string assetKey(const std::string &file, uint64_t variant) {
+		return std::filesystem::path(file).lexically_normal().generic_string() +
+			   "#" + std::to_string(variant);
 	}
 };
 
@@ -132,21 +175,27 @@ public:
 
 	/// Models
 	int ModelCount = 0;
-	Model<Vert> **M;
+	std::vector<std::shared_ptr<Model<Vert>>> M;
 	std::unordered_map<std::string, int> MeshIds;
-	std::unordered_map<std::string, std::vector<glm::vec3>> vecMap;
 	std::unordered_map<std::string, BoundingBox> bbMap;
 
 	/// Textures
 	int TextureCount = 0;
-	Texture **T;
+	std::vector<std::shared_ptr<Texture>> T;
 	std::unordered_map<std::string, int> TextureIds;
 
-	/// Descriptor sets and instances
+	/// Descriptor sets and instances; InstanceCount counts the slots,
+	/// despawned ones have a null id and wait in freeInstances
 	int InstanceCount = 0;
-	DescriptorSet **DS;
-	Instance *I;
+	std::vector<DescriptorSet *> DS;
+	std::vector<Instance> I;
+	std::vector<int> freeInstances;
 	std::unordered_map<std::string, int> InstanceIds;
+	/// Node k holds the transforms of instance k
+	TransformHierarchy Transforms;
+	/// Instances spawned or given another model, reported by the next
+	/// updateTransforms()
+	std::vector<int> placed;
 
 	/// Pipelines
 	Pipeline **P;
@@ -156,184 +205,489 @@ public:
 	/// Resource counter
 	ResourceAmount resCtr;
 
-	void countResources(std::string file) {
-		nlohmann::json js;
-		std::ifstream ifs(file);
+	/// Descriptor set elements per instance id, "default" for the others
+	std::unordered_map<std::string, std::vector<DescriptorSetElement>> Bindings;
+	/// Elements given to spawn(), dropped on despawn
+	std::unordered_map<std::string, std::vector<DescriptorSetElement>> SpawnBindings;
+	bool descriptorSetsReady = false;
 
-		if(!ifs.is_open()) {
-			std::cout << "Error! Scene file not found!";
-			exit(-1);
-		}
+	/// Reports edits to the scene file once watch() is called
+	FileWatcher watcher;
 
-		try {
-			ifs >> js;
-			ifs.close();
-
-			int instances = js["instances"].size();
-			int textures = 0;
-
-			// Count textures
-			for(auto i : js["instances"]) {
-				std::string layoutName = i["layout"];
-				nlohmann::json layouts = js["layouts"];
-				for(auto lt : layouts) {
-					if(lt["name"] == layoutName) {
-						for(auto el : lt["bindings"])
-							if(el["type"] == "img") textures++;
-					}
-				}
-			}
+	/// Models and textures, shared with the application
+	AssetRegistry<Vert> Assets;
+	/// Textures replaced by reload(), which the application may still bind
+	std::vector<std::shared_ptr<Texture>> replacedTextures;
 
-			resCtr.textureInPool = textures;
-			resCtr.uboInPool = 2 * instances;
-			resCtr.dsInPool = js["instances"].size();
-		} catch(const nlohmann::json::exception &e) {
-			std::cout << e.what() << '\n';
+	/// Set once preload() has queued model and texture decoding
+	bool preloaded = false;
+
+	/// Parsed scene, shared by every initialization phase
+	SceneDescription scene;
+	std::string sceneFile;
+
+	/// Parse file the first time any phase asks for it
+	const SceneDescription &describe(const std::string &file) {
+		if(file != sceneFile) {
+			scene = SceneInterpreter::parse(file);
+			sceneFile = file;
 		}
+		return scene;
 	}
 
-	void initLayouts(BaseProject *_BP, std::string file) {
-		BP = _BP;
-
-		nlohmann::json js;
-		std::ifstream ifs(file);
+	void countResources(std::string file) {
+		const SceneDescription &sd = describe(file);
 
-		if(!ifs.is_open()) {
-			std::cout << "Error! Scene file not found!";
-			exit(-1);
+		int textures = 0;
+		for(auto &inst : sd.instances) {
+			textures += sd.layouts[inst.layout].textures;
 		}
 
-		try {
-			ifs >> js;
-			ifs.close();
-
-			// Layouts
-			nlohmann::json ly = js["layouts"];
-			LayoutCount = ly.size();
-			std::cout << "Layout count: " << LayoutCount << "\n";
-			DSL = (DescriptorSetLayout **)calloc(LayoutCount,
-												 sizeof(DescriptorSetLayout *));
-			for(int k = 0; k < LayoutCount; k++) {
-				LayoutIds[ly[k]["name"]] = k;
-				DSL[k] = new DescriptorSetLayout();
-
-				auto bindings =
-					LayoutInterpreter::getBindings(ly[k]["bindings"]);
-				DSL[k]->init(BP, bindings);
-			}
-		} catch(const nlohmann::json::exception &e) {
-			std::cout << e.what() << '\n';
+		resCtr.textureInPool = textures;
+		resCtr.uboInPool = 2 * sd.instances.size();
+		resCtr.dsInPool = sd.instances.size();
+	}
+
+	void initLayouts(BaseProject *_BP, std::string file) {
+		BP = _BP;
+		const SceneDescription &sd = describe(file);
+
+		// Layouts
+		LayoutCount = sd.layouts.size();
+		std::cout << "Layout count: " << LayoutCount << "\n";
+		DSL = (DescriptorSetLayout **)calloc(LayoutCount,
+											 sizeof(DescriptorSetLayout *));
+		for(int k = 0; k < LayoutCount; k++) {
+			LayoutIds[sd.layouts[k].name] = k;
+			DSL[k] = new DescriptorSetLayout();
+			DSL[k]->init(BP, LayoutInterpreter::getBindings(sd.layouts[k].bindings));
 		}
 	}
 
 	void initPipelines(BaseProject *_BP, VertexDescriptor *VD, std::string file) {
 		BP = _BP;
+		const SceneDescription &sd = describe(file);
 
-		nlohmann::json js;
-		std::ifstream ifs(file);
+		// Pipelines
+		PipelineCount = sd.pipelines.size();
+		P = (Pipeline **)calloc(PipelineCount, sizeof(Pipeline *));
+		for(int k = 0; k < PipelineCount; k++) {
+			const PipelineDescription &pd = sd.pipelines[k];
+			PipelineIds[pd.name] = k;
 
-		if(!ifs.is_open()) {
-			std::cout << "Error! Scene file not found!";
-			exit(-1);
+			P[k] = new Pipeline();
+			P[k]->init(BP, VD, pd.vert, pd.frag, {DSL[pd.layout]});
 		}
+	}
 
-		try {
-			std::cout << "Parsing JSON\n";
-			ifs >> js;
-			ifs.close();
-
-			// Pipelines
-			nlohmann::json ppl = js["pipelines"];
-			PipelineCount = ppl.size();
-			P = (Pipeline **)calloc(PipelineCount, sizeof(Pipeline *));
-			for(int k = 0; k < PipelineCount; k++) {
-				PipelineIds[ppl[k]["name"]] = k;
-				std::string frag = ppl[k]["frag"];
-				std::string vert = ppl[k]["vert"];
-				std::string layout = ppl[k]["layout"];
-
-				P[k] = new Pipeline();
-				P[k]->init(BP, VD, vert, frag, {DSL[LayoutIds[layout]]});
-			}
-		} catch(const nlohmann::json::exception &e) {
-			std::cout << e.what() << '\n';
+	/**
+	 * Queue the CPU-side decoding of every model and texture on the
+	 * loader threads. It does not need the Vulkan device, so it can be
+	 * called before initVulkan(); init() collects the results.
+	 */
+	void preload(VertexDescriptor *VD, std::string file) {
+		this->VD = VD;
+		const SceneDescription &sd = describe(file);
+
+		// Models
+		ModelCount = sd.models.size();
+		std::cout << "Models count: " << ModelCount << "\n";
+
+		M.resize(ModelCount);
+		for(int k = 0; k < ModelCount; k++) {
+			const ModelDescription &md = sd.models[k];
+			MeshIds[md.id] = k;
+			M[k] = Assets.model(VD, md.file, md.format);
+		}
+
+		// Textures
+		TextureCount = sd.textures.size();
+		std::cout << "Textures count: " << TextureCount << "\n";
+
+		T.resize(TextureCount);
+		for(int k = 0; k < TextureCount; k++) {
+			const TextureDescription &td = sd.textures[k];
+			TextureIds[td.id] = k;
+			T[k] = Assets.texture(td.file, td.semantic);
 		}
+
+		preloaded = true;
 	}
 
 	void init(BaseProject *_BP, VertexDescriptor *VD, std::string file) {
 		BP = _BP;
 
-		nlohmann::json js;
-		std::ifstream ifs(file);
+		if(!preloaded) preload(VD, file);
+
+		// Only buffer and image creation happen here, the decoding
+		// has been running on the loader threads since preload().
+		// This also uploads what the application acquired from Assets.
+		Assets.initLoaded(BP);
+
+		const SceneDescription &sd = describe(file);
+
+		// Instances
+		InstanceCount = sd.instances.size();
+		std::cout << "Instances count: " << InstanceCount << "\n";
+
+		DS.assign(InstanceCount, nullptr);
+		I.assign(InstanceCount, Instance{});
+		for(int k = 0; k < InstanceCount; k++) {
+			const InstanceDescription &id = sd.instances[k];
+			const std::string &model = sd.models[id.model].id;
+			std::cout << k << "\t" << sd.name(id.id) << ", " << model << "("
+					  << id.model << "), " << sd.textures[id.texture].id << "("
+					  << id.texture << ")\n";
+
+			I[k].id = new std::string(sd.name(id.id));
+			InstanceIds[*I[k].id] = k;
+			I[k].Mid = id.model;
+			I[k].Tid = id.texture;
+			I[k].DSLid = id.layout;
+			I[k].Pid = id.pipeline;
+			I[k].BBid = new std::string(model);
+			I[k].Wm = Transforms.world(Transforms.add(id.parent, id.Wm));
+		}
+	}
+
+	/**
+	 * Load a model while the application runs, so that instances can
+	 * be spawned with it; a model with the same id is reused
+	 * @return its index in M
+	 */
+	int addModel(const std::string &id, const std::string &file, ModelType MT) {
+		auto it = MeshIds.find(id);
+		if(it != MeshIds.end()) return it->second;
+
+		M.push_back(Assets.model(VD, file, MT));
+		MeshIds[id] = ModelCount;
+		uploadAssets();
+		return ModelCount++;
+	}
+
+	/// Load a texture while the application runs, see addModel()
+	int addTexture(const std::string &id, const std::string &file,
+				   TextureSemantic semantic = ALBEDO) {
+		auto it = TextureIds.find(id);
+		if(it != TextureIds.end()) return it->second;
+
+		T.push_back(Assets.texture(file, semantic));
+		TextureIds[id] = TextureCount;
+		uploadAssets();
+		return TextureCount++;
+	}
+
+	/**
+	 * Add an instance while the application runs, in the slot of a
+	 * despawned one if any. The command buffers are recorded again
+	 * before their next use.
+	 * @param id unique instance id
+	 * @param model, layout, pipeline ids of scene elements
+	 * @param local transform, relative to parent if given
+	 * @param elements descriptor set elements, "default" ones if empty
+	 * @return the instance slot
+	 */
+	int spawn(const std::string &id, const std::string &model,
+			  const std::string &layout, const std::string &pipeline,
+			  const glm::mat4 &local, const std::string &parent = "",
+			  const std::vector<DescriptorSetElement> &elements = {}) {
+		if(InstanceIds.find(id) != InstanceIds.end()) {
+			throw std::runtime_error("instance " + id + " already exists");
+		}
+		int Mid = lookup(MeshIds, model, "model");
+		int DSLid = lookup(LayoutIds, layout, "layout");
+		int Pid = lookup(PipelineIds, pipeline, "pipeline");
+		int parentSlot = parent.empty() ? -1 : lookup(InstanceIds, parent, "instance");
+
+		int k;
+		if(!freeInstances.empty()) {
+			k = freeInstances.back();
+			freeInstances.pop_back();
+			Transforms.add(parentSlot, local, k);
+		} else {
+			k = Transforms.add(parentSlot, local);
+			I.emplace_back();
+			DS.push_back(nullptr);
+			InstanceCount++;
+		}
+
+		InstanceIds[id] = k;
+		I[k].id = new std::string(id);
+		I[k].Mid = Mid;
+		I[k].Tid = -1;
+		I[k].DSLid = DSLid;
+		I[k].Pid = Pid;
+		I[k].BBid = new std::string(model);
+		I[k].Wm = Transforms.world(k);
+		placed.push_back(k);
+
+		if(!elements.empty()) SpawnBindings[id] = elements;
+		if(descriptorSetsReady) createDescriptorSet(k);
+
+		BP->invalidateCommandBuffers();
+		return k;
+	}
 
-		if(!ifs.is_open()) {
-			std::cout << "Error! Scene file not found!";
-			exit(-1);
+	/**
+	 * Remove an instance and its descendants. Their descriptor sets are
+	 * destroyed once no command buffer in flight can use them.
+	 */
+	void despawn(const std::string &id) {
+		std::vector<int> nodes = Transforms.subtree(lookup(InstanceIds, id, "instance"));
+
+		for(auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+			int k = *it;
+			Transforms.remove(k);
+			InstanceIds.erase(*I[k].id);
+			bbMap.erase(*I[k].id);
+			SpawnBindings.erase(*I[k].id);
+			retireDescriptorSet(k);
+
+			delete I[k].id;
+			delete I[k].BBid;
+			I[k] = Instance{};
+			freeInstances.push_back(k);
 		}
 
+		BP->invalidateCommandBuffers();
+	}
+
+	/// Reload the scene file whenever it is saved, see pollReload()
+	void watch(const std::string &file) {
+		watcher.watch(file);
+	}
+
+	/**
+	 * Apply the edits made to the watched scene file since the last
+	 * call; meant to be called once per frame
+	 * @return true if the scene was reloaded
+	 */
+	bool pollReload() {
+		std::vector<std::string> changed = watcher.poll();
+		if(changed.empty()) return false;
+
+		reload(sceneFile);
+		return true;
+	}
+
+	/**
+	 * Diff file against the running scene and only apply what changed:
+	 * moved instances get their transform updated in place, new or
+	 * edited ones are spawned, removed ones despawned, retextured ones
+	 * get a new descriptor set, and only models and textures not loaded
+	 * yet are read. Layouts and pipelines need a restart. A scene that
+	 * fails to parse leaves everything as is.
+	 */
+	void reload(const std::string &file) {
+		auto start = std::chrono::steady_clock::now();
+
+		SceneDescription sd;
 		try {
-			std::cout << "Parsing JSON\n";
-			ifs >> js;
-			ifs.close();
-			std::cout << "\n\n\nScene contains " << js.size()
-					  << " definitions sections\n\n\n";
-
-			// Models
-			nlohmann::json ms = js["models"];
-			ModelCount = ms.size();
-			std::cout << "Models count: " << ModelCount << "\n";
-
-			M = (Model<Vert> **)calloc(ModelCount, sizeof(Model<Vert> *));
-			for(int k = 0; k < ModelCount; k++) {
-				MeshIds[ms[k]["id"]] = k;
-				std::string MT = ms[k]["format"].template get<std::string>();
-				M[k] = new Model<Vert>();
-
-				M[k]->init(BP, VD, ms[k]["model"].template get<std::string>(),
-						   (MT[0] == 'O') ? OBJ : ((MT[0] == 'G') ? GLTF : MGCG),
-						   ms[k]["id"], vecMap);
+			sd = SceneInterpreter::parse(file);
+		} catch(const std::exception &e) {
+			std::cout << "Scene not reloaded: " << e.what() << "\n";
+			return;
+		}
+
+		if(!sameLayoutsAndPipelines(sd)) {
+			std::cout << "WARNING: layout and pipeline edits need a restart\n";
+		}
+
+		// Assets: new ids are loaded, edited models replaced
+		std::unordered_map<std::string, const ModelDescription *> oldModels;
+		std::unordered_map<std::string, const TextureDescription *> oldTextures;
+		for(auto &md : scene.models) oldModels[md.id] = &md;
+		for(auto &td : scene.textures) oldTextures[td.id] = &td;
+
+		// Previous texture to the one replacing it
+		std::unordered_map<Texture *, Texture *> retextured;
+		std::unordered_set<Texture *> edited;
+		int loaded = 0;
+		for(auto &md : sd.models) {
+			auto it = MeshIds.find(md.id);
+			auto old = oldModels.find(md.id);
+			if(it == MeshIds.end()) {
+				M.push_back(Assets.model(VD, md.file, md.format));
+				MeshIds[md.id] = ModelCount++;
+				loaded++;
+			} else if(old != oldModels.end() && (old->second->file != md.file ||
+												 old->second->format != md.format)) {
+				// Command buffers in flight may still draw the old one
+				std::shared_ptr<Model<Vert>> previous = M[it->second];
+				M[it->second] = Assets.model(VD, md.file, md.format);
+				BP->retire([previous]() {});
+				for(auto &inst : InstanceIds) {
+					if(*I[inst.second].BBid == md.id) placed.push_back(inst.second);
+				}
+				loaded++;
+			}
+		}
+		for(auto &td : sd.textures) {
+			auto it = TextureIds.find(td.id);
+			auto old = oldTextures.find(td.id);
+			if(it == TextureIds.end()) {
+				T.push_back(Assets.texture(td.file, td.semantic));
+				TextureIds[td.id] = TextureCount++;
+				loaded++;
+			} else if(old != oldTextures.end() && (old->second->file != td.file ||
+												   old->second->semantic != td.semantic)) {
+				// Descriptor sets of the application may still sample the
+				// previous one, it is kept until cleanup
+				replacedTextures.push_back(T[it->second]);
+				T[it->second] = Assets.texture(td.file, td.semantic);
+				retextured[replacedTextures.back().get()] = T[it->second].get();
+				edited.insert(T[it->second].get());
+				loaded++;
+			}
+		}
+		if(loaded > 0) uploadAssets();
+
+		// The scene descriptor sets sample the edited textures from now on
+		for(auto *bindings : {&Bindings, &SpawnBindings}) {
+			for(auto &b : *bindings) {
+				for(auto &e : b.second) {
+					auto r = retextured.find(e.tex);
+					if(r != retextured.end()) e.tex = r->second;
+				}
 			}
+		}
 
-			// Textures
-			nlohmann::json ts = js["textures"];
-			TextureCount = ts.size();
-			std::cout << "Textures count: " << TextureCount << "\n";
+		// Instances: removed or structurally edited ones are despawned
+		// (with their descendants), then whatever is missing is spawned.
+		// Those given another texture, or binding an edited one, get a
+		// new descriptor set. Instances spawned by the application are
+		// otherwise left alone.
+		std::unordered_map<std::string, const InstanceDescription *> next;
+		std::unordered_set<std::string> previous;
+		for(auto &id : sd.instances) next[sd.name(id.id)] = &id;
+		for(auto &id : scene.instances) previous.insert(scene.name(id.id));
+
+		std::vector<std::string> stale;
+		std::vector<int> refresh;
+		int moved = 0;
+		for(auto &inst : InstanceIds) {
+			int k = inst.second;
+			auto it = next.find(inst.first);
+			if(it == next.end()) {
+				if(previous.count(inst.first) > 0) {
+					stale.push_back(inst.first);
+				} else if(!edited.empty() && samples(k, edited)) {
+					refresh.push_back(k);
+				}
+				continue;
+			}
 
-			T = (Texture **)calloc(ModelCount, sizeof(Texture *));
-			for(int k = 0; k < TextureCount; k++) {
-				TextureIds[ts[k]["id"]] = k;
-				T[k] = new Texture();
+			const InstanceDescription &id = *it->second;
+			int p = Transforms.parent(k);
+			std::string parent = id.parent >= 0 ? sd.name(sd.instances[id.parent].id) : "";
+			if(sd.models[id.model].id != *I[k].BBid ||
+			   findId(LayoutIds, sd.layouts[id.layout].name) != I[k].DSLid ||
+			   findId(PipelineIds, sd.pipelines[id.pipeline].name) != I[k].Pid ||
+			   parent != (p >= 0 ? *I[p].id : "")) {
+				stale.push_back(inst.first);
+				continue;
+			}
+			if(Transforms.local(k) != id.Wm) {
+				Transforms.setLocal(k, id.Wm);
+				moved++;
+			}
 
-				T[k]->init(BP, ts[k]["texture"].template get<std::string>().c_str());
+			int Tid = findId(TextureIds, sd.textures[id.texture].id);
+			if(Tid != I[k].Tid) {
+				I[k].Tid = Tid;
+				refresh.push_back(k);
+			} else if(!edited.empty() && samples(k, edited)) {
+				refresh.push_back(k);
 			}
+		}
+
+		int despawned = InstanceIds.size();
+		for(auto &id : stale) {
+			// May already be gone with an ancestor
+			if(InstanceIds.find(id) != InstanceIds.end()) despawn(id);
+		}
+		despawned -= InstanceIds.size();
+
+		for(int k : refresh) {
+			// May be gone with a stale ancestor
+			if(I[k].id != nullptr) refreshDescriptorSet(k);
+		}
 
-			// Instances
-			nlohmann::json is = js["instances"];
-			InstanceCount = is.size();
-			std::cout << "Instances count: " << InstanceCount << "\n";
-
-			DS = (DescriptorSet **)calloc(InstanceCount, sizeof(DescriptorSet *));
-			I = (Instance *)calloc(InstanceCount, sizeof(Instance));
-			for(int k = 0; k < InstanceCount; k++) {
-				std::cout << k << "\t" << is[k]["id"] << ", " << is[k]["model"]
-						  << "(" << MeshIds[is[k]["model"]] << "), "
-						  << is[k]["texture"] << "("
-						  << TextureIds[is[k]["texture"]] << ")\n";
-
-				InstanceIds[is[k]["id"]] = k;
-				I[k].id = new std::string(is[k]["id"]);
-				I[k].Mid = MeshIds[is[k]["model"]];
-				I[k].Tid = TextureIds[is[k]["texture"]];
-				I[k].DSLid = LayoutIds[is[k]["layout"]];
-				I[k].Pid = PipelineIds[is[k]["pipeline"]];
-				I[k].BBid = new std::string(is[k]["model"]);
-
-				I[k].Wm =
-					TransformInterpreter::computeWorld(is[k]["transforms"]);
+		// Parents come first in the description
+		int spawned = 0;
+		for(auto &id : sd.instances) {
+			std::string name = sd.name(id.id);
+			if(InstanceIds.find(name) != InstanceIds.end()) continue;
+
+			try {
+				int k = spawn(name, sd.models[id.model].id, sd.layouts[id.layout].name,
+							  sd.pipelines[id.pipeline].name, id.Wm,
+							  id.parent >= 0 ? sd.name(sd.instances[id.parent].id) : "");
+				I[k].Tid = findId(TextureIds, sd.textures[id.texture].id);
+				refreshDescriptorSet(k);
+				spawned++;
+			} catch(const std::runtime_error &e) {
+				std::cout << "WARNING: instance " << name << " not spawned: "
+						  << e.what() << "\n";
 			}
-		} catch(const nlohmann::json::exception &e) {
-			std::cout << e.what() << '\n';
 		}
+
+		scene = std::move(sd);
+		sceneFile = file;
+
+		std::cout << "Scene reloaded in "
+				  << std::chrono::duration<float, std::milli>(
+						 std::chrono::steady_clock::now() - start).count()
+				  << "ms: " << moved << " moved, " << refresh.size() << " retextured, "
+				  << spawned << " spawned, " << despawned << " despawned, " << loaded
+				  << " assets loaded\n";
+	}
+
+	/// Move an instance (and its children) relative to its parent
+	void setLocalTransform(int instance, const glm::mat4 &local) {
+		Transforms.setLocal(instance, local);
+	}
+
+	void setLocalTransform(const std::string &id, const glm::mat4 &local) {
+		auto it = InstanceIds.find(id);
+		if(it == InstanceIds.end()) {
+			throw std::runtime_error("unknown instance id: " + id);
+		}
+		Transforms.setLocal(it->second, local);
+	}
+
+	/**
+	 * Refresh the world matrix of the instances moved since the
+	 * last call and of their descendants; call once per frame
+	 * @param changed called with every instance moved, spawned or
+	 * given another model since the last call, to place its collider
+	 */
+	template<class F>
+	void updateTransforms(F &&changed) {
+		Transforms.update([this, &changed](int k) {
+			I[k].Wm = Transforms.world(k);
+			changed(k);
+		});
+		for(int k : placed) {
+			// May have been despawned since
+			if(I[k].id != nullptr) changed(k);
+		}
+		placed.clear();
+	}
+
+	/// Texture with the given scene id
+	Texture *texture(const std::string &id) {
+		return T[lookup(TextureIds, id, "texture")].get();
+	}
+
+	/// Layout with the given scene id
+	DescriptorSetLayout *layout(const std::string &id) {
+		return DSL[lookup(LayoutIds, id, "layout")];
+	}
+
+	/// Pipeline with the given scene id
+	Pipeline *pipeline(const std::string &id) {
+		return P[lookup(PipelineIds, id, "pipeline")];
 	}
 
 	void createPipelines() {
@@ -344,17 +698,12 @@ public:
 
 	void pipelinesAndDescriptorSetsInit(
 		std::unordered_map<std::string, std::vector<DescriptorSetElement>> dsInst) {
-		// Assumed to always exist
-		auto defaultBinding = dsInst["default"];
+		Bindings = std::move(dsInst);
 
 		for(auto inst : InstanceIds) {
-			int i = inst.second;
-			DS[i] = new DescriptorSet();
-			if(dsInst.find(inst.first) != dsInst.end())
-				DS[i]->init(BP, DSL[I[i].DSLid], dsInst[inst.first]);
-			else
-				DS[i]->init(BP, DSL[I[i].DSLid], defaultBinding);
+			createDescriptorSet(inst.second);
 		}
+		descriptorSetsReady = true;
 	}
 
 	void pipelinesAndDescriptorSetsCleanup() {
@@ -362,25 +711,20 @@ public:
 			P[i]->cleanup();
 		}
 		for(int i = 0; i < InstanceCount; i++) {
+			if(DS[i] == nullptr) continue;
 			DS[i]->cleanup();
 			delete DS[i];
+			DS[i] = nullptr;
 		}
+		descriptorSetsReady = false;
 	}
 
 	void localCleanup() {
-		// Cleanup textures
-		for(int i = 0; i < TextureCount; i++) {
-			T[i]->cleanup();
-			delete T[i];
-		}
-		free(T);
-
-		// Cleanup models
-		for(int i = 0; i < ModelCount; i++) {
-			M[i]->cleanup();
-			delete M[i];
-		}
-		free(M);
+		// Release textures & models, they are destroyed
+		// once the application drops its handles too
+		T.clear();
+		replacedTextures.clear();
+		M.clear();
 
 		// Cleanup layouts
 		for(int i = 0; i < LayoutCount; i++) {
@@ -389,11 +733,13 @@ public:
 		}
 		free(DSL);
 
-		free(DS);
 		for(int i = 0; i < InstanceCount; i++) {
 			delete I[i].id;
+			delete I[i].BBid;
 		}
-		free(I);
+		I.clear();
+		DS.clear();
+		freeInstances.clear();
 
 		// Destroy pipelines
 		for(int i = 0; i < PipelineCount; i++) {
@@ -405,6 +751,8 @@ public:
 
 	void populateCommandBuffer(VkCommandBuffer commandBuffer, int currentImage) {
 		for(int i = 0; i < InstanceCount; i++) {
+			if(I[i].id == nullptr) continue;
+
 			P[I[i].Pid]->bind(commandBuffer);
 			M[I[i].Mid]->bind(commandBuffer);
 			DS[i]->bind(commandBuffer, *P[I[i].Pid], 0, currentImage);
@@ -414,4 +762,110 @@ public:
 							 1, 0, 0, 0);
 		}
 	}
+
+private:
+	static int findId(const std::unordered_map<std::string, int> &ids,
+					  const std::string &id) {
+		auto it = ids.find(id);
+		return it != ids.end() ? it->second : -1;
+	}
+
+	bool sameLayoutsAndPipelines(const SceneDescription &sd) {
+		if(sd.layouts.size() != scene.layouts.size() ||
+		   sd.pipelines.size() != scene.pipelines.size()) {
+			return false;
+		}
+		for(size_t i = 0; i < sd.layouts.size(); i++) {
+			const LayoutDescription &a = sd.layouts[i], &b = scene.layouts[i];
+			if(a.name != b.name || a.bindings.size() != b.bindings.size()) return false;
+			for(size_t j = 0; j < a.bindings.size(); j++) {
+				if(a.bindings[j].type != b.bindings[j].type ||
+				   a.bindings[j].stage != b.bindings[j].stage) {
+					return false;
+				}
+			}
+		}
+		for(size_t i = 0; i < sd.pipelines.size(); i++) {
+			const PipelineDescription &a = sd.pipelines[i], &b = scene.pipelines[i];
+			if(a.name != b.name || a.vert != b.vert || a.frag != b.frag ||
+			   a.layout != b.layout) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static int lookup(const std::unordered_map<std::string, int> &ids,
+					  const std::string &id, const char *kind) {
+		auto it = ids.find(id);
+		if(it == ids.end()) {
+			throw std::runtime_error(std::string("unknown ") + kind + " id: " + id);
+		}
+		return it->second;
+	}
+
+	/// Descriptor set elements of instance i, before its own texture
+	const std::vector<DescriptorSetElement> &elementsOf(int i) const {
+		// "default" is assumed to always exist
+		auto it = SpawnBindings.find(*I[i].id);
+		if(it == SpawnBindings.end()) {
+			it = Bindings.find(*I[i].id);
+			if(it == Bindings.end()) it = Bindings.find("default");
+		}
+		return it->second;
+	}
+
+	/**
+	 * Descriptor set of instance i; instances of the scene file sample
+	 * their own texture in the first texture binding
+	 */
+	void createDescriptorSet(int i) {
+		std::vector<DescriptorSetElement> elements = elementsOf(i);
+		if(I[i].Tid >= 0) {
+			for(auto &e : elements) {
+				if(e.type != TEXTURE) continue;
+				e.tex = T[I[i].Tid].get();
+				break;
+			}
+		}
+
+		DS[i] = new DescriptorSet();
+		DS[i]->init(BP, DSL[I[i].DSLid], elements);
+	}
+
+	/// Destroy the descriptor set of instance k once no command buffer
+	/// in flight can use it
+	void retireDescriptorSet(int k) {
+		if(DS[k] == nullptr) return;
+		DescriptorSet *ds = DS[k];
+		BP->retire([ds]() {
+			ds->cleanup();
+			delete ds;
+		});
+		DS[k] = nullptr;
+	}
+
+	/// Create the descriptor set of instance k again, after its textures changed
+	void refreshDescriptorSet(int k) {
+		if(!descriptorSetsReady) return;
+		retireDescriptorSet(k);
+		createDescriptorSet(k);
+		BP->invalidateCommandBuffers();
+	}
+
+	/// Whether the descriptor set of instance k binds one of textures
+	bool samples(int k, const std::unordered_set<Texture *> &textures) const {
+		if(I[k].Tid >= 0 && textures.count(T[I[k].Tid].get()) > 0) return true;
+		for(auto &e : elementsOf(k)) {
+			if(e.type == TEXTURE && textures.count(e.tex) > 0) return true;
+		}
+		return false;
+	}
+
+	/// Create the buffers and images of the assets added at runtime
+	void uploadAssets() {
+		BP->beginUploadBatch();
+		Assets.initLoaded(BP);
+		BP->endUploadBatch();
+	}
 };
\ No newline at end of file
@@ -0,0 +1,762 @@
+// Rocket, coins and light of the game, stepped at a fixed rate from the
+// keys held: nothing in here needs Vulkan or a window, so that the same
+// simulation runs in the game and headless
+
+#include <random>
+#include <sstream>
+
+struct SphereCollider {
+	glm::vec3 center;
+	float radius;
+};
+
+enum RocketState { MOVING, RESTING };
+
+/**
+ * Keys held during one tick
+ */
+struct SimInput {
+	enum Key {
+		W = 1 << 0,
+		S = 1 << 1,
+		A = 1 << 2,
+		D = 1 << 3,
+		SPACE = 1 << 4,
+		X = 1 << 5,
+		Z = 1 << 6,
+		LEFT = 1 << 7,
+		RIGHT = 1 << 8,
+		UP = 1 << 9,
+		DOWN = 1 << 10
+	};
+	static const int KEY_COUNT = 11;
+
+	uint32_t keys = 0;
+
+	bool held(Key key) const { return (keys & key) != 0; }
+
+	/// Name of the i-th key in input scripts
+	static const char *name(int i) {
+		static const char *const names[KEY_COUNT] = {
+			"W", "S", "A", "D", "SPACE", "X", "Z", "LEFT", "RIGHT", "UP", "DOWN"};
+		return names[i];
+	}
+};
+
+/**
+ * Inputs of a run, one tick after the other: each line of a script
+ * holds a number of ticks and the keys held meanwhile, such as
+ * "120 SPACE W" ('#' starts a comment)
+ */
+class InputScript {
+public:
+	void load(const std::string &file) {
+		std::ifstream in(file);
+		if(!in.is_open()) {
+			std::cout << "Failed to open: " << file << "\n";
+			throw std::runtime_error("failed to open file!");
+		}
+
+		std::string line;
+		while(std::getline(in, line)) {
+			line = line.substr(0, line.find('#'));
+			std::istringstream words(line);
+			int ticks;
+			if(!(words >> ticks)) continue;
+
+			SimInput input;
+			std::string key;
+			while(words >> key) {
+				int i = 0;
+				while(i < SimInput::KEY_COUNT && key != SimInput::name(i)) i++;
+				if(i == SimInput::KEY_COUNT) {
+					throw std::runtime_error("unknown key in " + file + ": " + key);
+				}
+				input.keys |= 1u << i;
+			}
+			for(int t = 0; t < ticks; t++) inputs.push_back(input);
+		}
+	}
+
+	size_t size() const { return inputs.size(); }
+
+	/// Input of the tick, nothing held past the end of the script
+	SimInput at(size_t tick) const {
+		return tick < inputs.size() ? inputs[tick] : SimInput();
+	}
+
+private:
+	std::vector<SimInput> inputs;
+};
+
+/**
+ * Writes the inputs of every tick as an InputScript
+ */
+class InputRecorder {
+public:
+	InputRecorder() = default;
+	InputRecorder(const InputRecorder &) = delete;
+	InputRecorder &operator=(const InputRecorder &) = delete;
+
+	void open(const std::string &file) {
+		out.open(file, std::ios::trunc);
+		if(!out.is_open()) {
+			std::cout << "Failed to open: " << file << "\n";
+			throw std::runtime_error("failed to open file!");
+		}
+	}
+
+	bool isOpen() const { return out.is_open(); }
+
+	void record(const SimInput &input) {
+		if(ticks > 0 && input.keys != last.keys) flush();
+		last = input;
+		ticks++;
+	}
+
+	~InputRecorder() {
+		if(out.is_open()) flush();
+	}
+
+private:
+	std::ofstream out;
+	SimInput last;
+	int ticks = 0;
+
+	void flush() {
+		if(ticks == 0) return;
+		out << ticks;
+		for(int i = 0; i < SimInput::KEY_COUNT; i++) {
+			if(last.held((SimInput::Key)(1u << i))) out << " " << SimInput::name(i);
+		}
+		out << "\n";
+		ticks = 0;
+	}
+};
+
+/**
+ * How the rocket flies, the same for every tick
+ */
+struct RocketParams {
+	float moveSpeed = 5.0f;
+	float gravity = 0.1f;
+	/// Tilt, in degrees, gained per second while turning
+	float tiltSpeed = 120.0f;
+	/// Largest tilt, in degrees
+	float maxTilt = 20.0f;
+	/// Tilt past which the rocket is straightened, and how fast
+	float stabilizeThreshold = 3.0f;
+	float stabilizeRate = 20.0f;
+};
+
+/// What moves between two ticks, drawn interpolated
+struct SimState {
+	glm::vec3 rocketPosition;
+	glm::vec3 rocketRotation;
+	float rocketRotHor;
+	float rocketRotVert;
+	glm::vec3 cameraRotation;
+	float coinRot;
+	float cTime;
+};
+
+class Simulation {
+public:
+	// Definition of variables needed for rocket movement, coin placing and
+	// general game logic
+	RocketParams params;
+	glm::vec3 rocketPosition;
+	glm::vec3 rocketDirection;
+	glm::vec3 rocketRotation;
+	SphereCollider rocketCollider;
+	RocketState rocketState;
+	/// Table of bounding boxes <iId, bbox>, shared with the scene
+	std::unordered_map<std::string, BoundingBox> &bbMap;
+	/// Broadphase over bbMap, box i belonging to colliderIds[i]
+	BVH colliders;
+	std::vector<std::string> colliderIds;
+	std::unordered_map<std::string, int> colliderItems;
+	bool collidersChanged = true;
+	/// Triangles and world matrix of each OBJECT box
+	struct ColliderMesh {
+		const MeshBVH *triangles;
+		glm::mat4 World;
+	};
+	std::unordered_map<std::string, ColliderMesh> colliderMeshes;
+	/// Test the triangles of the boxes the rocket touches
+	bool meshCollision = true;
+	/// Boxes the rocket can slide along in one tick
+	const int MAX_SWEEP_STEPS = 4;
+	/// Steps to reach the triangles inside a box hit by the rocket
+	const int MAX_ADVANCE_STEPS = 16;
+	/// Gap under which the swept rocket is touching
+	const float CONTACT_SKIN = 0.001f;
+	glm::vec3 restingPosition;
+	float rocketVerticalSpeed;
+	glm::vec3 rocketSpeed;
+	float rocketRotHor;
+	float rocketRotVert;
+	bool wasGoingRight;
+	bool wasGoingUp;
+
+	// Fixed step of the simulation, whatever the frame rate
+	const float DELTA_T = 0.016f;
+	const float TURN_TIME = 36.0f;
+	// Angular velocity of ambient light
+	const float LIGHT_ROT_SPEED = 2.0f * M_PI / TURN_TIME;
+
+	glm::vec3 rocketCameraRotation;
+
+	const glm::vec3 DEFAULT_POSITION = glm::vec3(0.0f, 1.5f, 4.0f);
+	const glm::vec3 BETWEEN_BED_AND_CLOSET = glm::vec3(-2.0f, 0.5f, 1.0f);
+	const glm::vec3 ABOVE_CLOSET = glm::vec3(-1.0f, 3.0f, 0.4f);
+	const glm::vec3 ABOVE_RECORD_TABLE = glm::vec3(-3.0f, 2.0f, 7.0f);
+	const glm::vec3 BEHIND_RED_COLUMN = glm::vec3(5.0f, 2.0f, 7.0f);
+	const std::vector<glm::vec3> coinLocations = {DEFAULT_POSITION,
+												  BETWEEN_BED_AND_CLOSET,
+												  ABOVE_CLOSET, ABOVE_RECORD_TABLE,
+												  BEHIND_RED_COLUMN};
+
+	const glm::vec3 CROWN_DEFAULT_POSITION = glm::vec3(0.0f, 0.5f, 4.0f);
+	const glm::vec3 CROWN_ABOVE_CHAIR = glm::vec3(-5.0f, 1.0f, 7.0f);
+	const glm::vec3 CROWN_ABOVE_GDESK = glm::vec3(3.0f, 1.2f, 1.0f);
+	const glm::vec3 CROWN_FRONT_DOOR = glm::vec3(-0.5f, 3.0f, 7.0f);
+	const glm::vec3 CROWN_ABOVE_PLANT = glm::vec3(5.5f, 1.4f, 7.5f);
+	const std::vector<glm::vec3> coinCrownLocations = {CROWN_DEFAULT_POSITION,
+													   CROWN_ABOVE_CHAIR,
+													   CROWN_ABOVE_GDESK,
+													   CROWN_FRONT_DOOR,
+													   CROWN_ABOVE_PLANT};
+
+	const glm::vec3 THUNDER_DEFAULT_POSITION = glm::vec3(0.0f, 2.5f, 4.0f);
+	const glm::vec3 THUNDER_ABOVE_SDESK = glm::vec3(5.3f, 1.2f, 2.0f);
+	const glm::vec3 THUNDER_FRONT_CLOCK = glm::vec3(-5.5f, 2.0f, 3.0f);
+	const glm::vec3 THUNDER_BEHIND_COLUMN = glm::vec3(4.5f, 2.0f, 6.0f);
+	const glm::vec3 THUNDER_ABOVE_PS5 = glm::vec3(2.4f, 1.5f, 0.55f);
+	const std::vector<glm::vec3> coinThunderLocations = {THUNDER_DEFAULT_POSITION,
+														 THUNDER_ABOVE_SDESK,
+														 THUNDER_FRONT_CLOCK,
+														 THUNDER_BEHIND_COLUMN,
+														 THUNDER_ABOVE_PS5};
+	// The three coins used to share a 2.0 spin each frame
+	const float COIN_ROT_SPEED = 6.0f;
+	float coinRot;
+	/// Time along the turn of the ambient light
+	float cTime;
+	int coinLocation;
+	int coinCrownLocation;
+	int coinThunderLocation;
+	/// Local bounds of the coins, set before the first tick
+	ModelBounds coinBounds;
+	ModelBounds coinCrownBounds;
+	ModelBounds coinThunderBounds;
+	int coinsCollected;
+	/// Where collected coins show up again
+	std::minstd_rand rng;
+
+	explicit Simulation(std::unordered_map<std::string, BoundingBox> &bbMap)
+		: bbMap(bbMap) {
+		reset();
+	}
+
+	/**
+	 * Back to the start of the game, the scene boxes being kept
+	 */
+	void reset() {
+		// Rocket parameters
+		rocketPosition = glm::vec3(-1.0f, 2.0f, 4.0f);
+		rocketDirection = glm::vec3(0.0f, 0.0f, 0.0f);
+		rocketRotation = glm::vec3(0.0f, 0.0f, 0.0f);
+		rocketState = MOVING;
+		rocketVerticalSpeed = 0.0f;
+		rocketSpeed = glm::vec3(0.0f, 0.0f, 0.0f);
+		rocketRotHor = 0.0f;
+		rocketRotVert = 0.0f;
+		wasGoingRight = false;
+		wasGoingUp = false;
+		rocketCollider.center = rocketPosition;
+		rocketCollider.radius = 0.05f;
+		rocketCameraRotation = glm::vec3(0.0f, 0.0f, 0.0f);
+
+		// Coin parameters
+		coinRot = 0.0f;
+		coinLocation = 0;
+		coinCrownLocation = 0;
+		coinThunderLocation = 0;
+		coinsCollected = 0;
+		rng.seed(std::minstd_rand::default_seed);
+		cTime = 0.0f;
+	}
+
+	/**
+	 * Helper function for checking collisions
+	 */
+	bool checkCollision(const SphereCollider& sphere, const BoundingBox& box) {
+		float x = glm::max(box.min.x, glm::min(sphere.center.x, box.max.x));
+		float y = glm::max(box.min.y, glm::min(sphere.center.y, box.max.y));
+		float z = glm::max(box.min.z, glm::min(sphere.center.z, box.max.z));
+
+		float distance = glm::sqrt((x - sphere.center.x) * (x - sphere.center.x) +
+								   (y - sphere.center.y) * (y - sphere.center.y) +
+								   (z - sphere.center.z) * (z - sphere.center.z));
+
+		return distance < sphere.radius;
+	}
+
+	/**
+	 * Place a bounding box on scene, refreshed at every call
+	 * @param mId id of the model in the scene
+	 * @param bounds local bounds of the model of the instance
+	 * @param triangles collision mesh of the model, if any
+	 * @param iId id of the model instance in the scene
+	 * @param World world matrix of colliding mesh
+	 */
+	void placeObject(const std::string &mId, const ModelBounds& bounds,
+					 const MeshBVH *triangles, const std::string &iId,
+					 const glm::mat4& World) {
+		BoundingBox bbox;
+
+		worldBounds(bounds, World, bbox.min, bbox.max);
+		bbox.max = glm::round(bbox.max * 100.0f) / 100.0f;
+		bbox.min = glm::round(bbox.min * 100.0f) / 100.0f;
+		(mId.compare(0, 4, "coin") == 0) ? bbox.cType = COLLECTIBLE
+										  : bbox.cType = OBJECT;
+
+		bbMap[iId] = bbox;
+		if(bbox.cType == OBJECT && triangles != nullptr) {
+			colliderMeshes[iId] = {triangles, World};
+		}
+
+		auto item = colliderItems.find(iId);
+		if(item != colliderItems.end()) {
+			colliders.refit(item->second, bbox.min, bbox.max);
+		} else {
+			collidersChanged = true;
+		}
+	}
+
+	/**
+	 * Build the broadphase again if boxes were added to or removed from
+	 * bbMap, moved boxes are already refitted by placeObject()
+	 */
+	void updateColliders() {
+		if(!collidersChanged && colliderIds.size() == bbMap.size()) return;
+
+		std::vector<BoundingBox> boxes;
+		boxes.reserve(bbMap.size());
+		colliderIds.clear();
+		colliderItems.clear();
+		for(auto &bb : bbMap) {
+			colliderItems[bb.first] = boxes.size();
+			colliderIds.push_back(bb.first);
+			boxes.push_back(bb.second);
+		}
+		colliders.build(boxes);
+		collidersChanged = false;
+
+		for(auto it = colliderMeshes.begin(); it != colliderMeshes.end();) {
+			it = colliderItems.count(it->first) > 0 ? std::next(it)
+													: colliderMeshes.erase(it);
+		}
+	}
+
+	/**
+	 * Order broadphase results by box id, so that contacts are resolved
+	 * in the same order whatever the shape of the tree
+	 */
+	void sortById(std::vector<int> &items) const {
+		std::sort(items.begin(), items.end(),
+				  [&](int a, int b) { return colliderIds[a] < colliderIds[b]; });
+	}
+
+	/**
+	 * Point of a collider nearest to center, on the triangles of its
+	 * model once its box is touched, or on the box itself
+	 * @param id id of the collider in bbMap
+	 * @return false if the collider is farther than radius
+	 */
+	bool contactPoint(const std::string &id, const glm::vec3 &center, float radius,
+					  glm::vec3 &point) {
+		const BoundingBox &box = bbMap[id];
+		if(!checkCollision({center, radius}, box)) return false;
+		point = glm::clamp(center, box.min, box.max);
+
+		auto mesh = colliderMeshes.find(id);
+		if(!meshCollision || box.cType != OBJECT || mesh == colliderMeshes.end() ||
+		   mesh->second.triangles->empty()) {
+			return true;
+		}
+		return mesh->second.triangles->nearest(mesh->second.World, center,
+														 radius, point);
+	}
+
+	/**
+	 * Carry the contact time t with a box on to the triangles inside it,
+	 * advancing the rocket as far as the nearest triangle allows
+	 * @return false if the rocket gets past the triangles
+	 */
+	bool sweepMesh(const ColliderMesh &mesh, const glm::vec3 &motion, float &t) {
+		float length = glm::length(motion);
+		if(length == 0.0f) return false;
+
+		for(int i = 0; i < MAX_ADVANCE_STEPS; i++) {
+			glm::vec3 center = rocketPosition + motion * t;
+			glm::vec3 point;
+			if(!mesh.triangles->nearest(
+				   mesh.World, center, rocketCollider.radius + length * (1.0f - t),
+				   point)) {
+				return false;
+			}
+
+			glm::vec3 outward = center - point;
+			float gap = glm::length(outward) - rocketCollider.radius;
+			if(gap <= CONTACT_SKIN) {
+				// Sliding along the triangle is not a hit
+				return glm::dot(outward, motion) < 0.0f;
+			}
+			t += gap / length;
+			if(t >= 1.0f) return false;
+		}
+		return true;
+	}
+
+	/**
+	 * Push the rocket out of the box it touches and slide it along the
+	 * surface, or collect the coin
+	 * @param collisionId id of the touched box in bbMap
+	 * @param closestPoint point of the collider nearest to the rocket
+	 */
+	void resolveContact(const std::string &collisionId,
+						const glm::vec3 &closestPoint) {
+		switch(bbMap[collisionId].cType) {
+			case OBJECT: {
+				// Calculate the normal of the collision surface
+				glm::vec3 difference = rocketPosition - closestPoint;
+				glm::vec3 normal(0.0f, 1.0f, 0.0f);
+				if(glm::dot(difference, difference) > 0.0f) {
+					normal = glm::normalize(difference);
+				} else if(glm::dot(rocketSpeed, rocketSpeed) > 0.0f) {
+					// Centre right on the surface: back out the way it came
+					normal = glm::normalize(-rocketSpeed);
+				}
+				// Move the sphere out of collision along the normal
+				rocketPosition = closestPoint + normal * rocketCollider.radius;
+				// Adjust the sphere's velocity to slide along the AABB surface
+				float dotProduct = glm::dot(rocketSpeed, normal);
+				glm::vec3 correction = normal * dotProduct;
+				rocketSpeed -= correction;
+				if(rocketPosition.y <=
+					   bbMap[collisionId].max.y + rocketCollider.radius &&  // If the collision is coming from above
+				   !(std::abs(normal.x) > 0.5f || std::abs(normal.z) > 0.5f) &&	 // Not from the side
+				   normal.y != -1.0f) {	 // Not from below
+					rocketState = RESTING;
+					restingPosition.x = rocketPosition.x;
+					restingPosition.y = rocketPosition.y + 0.01f;
+					restingPosition.z = rocketPosition.z;
+					rocketSpeed = glm::vec3(0.0f);
+				}
+				break;
+			}
+			case COLLECTIBLE: {
+				if(collisionId == "coin") {
+					coinLocation = (rng() % (4 - 0 + 1));
+				} else if(collisionId == "coinCrown") {
+					coinCrownLocation = (rng() % (4 - 0 + 1));
+				} else {
+					coinThunderLocation = (rng() % (4 - 0 + 1));
+				}
+				coinsCollected++;
+				bbMap.erase(collisionId);
+				break;
+			}
+		}
+	}
+
+	/**
+	 * Move the rocket for dt at its speed without passing through boxes:
+	 * it stops where it first touches one, slides along it, and goes on
+	 * with the time left, coins on the way being collected
+	 */
+	void sweepRocket(float dt) {
+		for(int step = 0; step < MAX_SWEEP_STEPS && dt > 0.0f; step++) {
+			glm::vec3 motion = rocketSpeed * dt;
+			glm::vec3 end = rocketPosition + motion;
+
+			std::vector<int> candidates;
+			colliders.overlaps(glm::min(rocketPosition, end) - rocketCollider.radius,
+							   glm::max(rocketPosition, end) + rocketCollider.radius,
+							   candidates);
+
+			float tHit = 1.0f;
+			std::string hitId;
+			std::vector<std::pair<float, std::string>> coins;
+			sortById(candidates);
+			for(int c : candidates) {
+				auto bb = bbMap.find(colliderIds[c]);
+				float t;
+				if(bb == bbMap.end() ||
+				   !sweepSphere(rocketPosition, rocketCollider.radius, motion,
+								bb->second, t)) {
+					continue;
+				}
+
+				if(bb->second.cType == COLLECTIBLE) {
+					coins.push_back({t, bb->first});
+					continue;
+				}
+				if(t >= tHit) continue;
+
+				auto mesh = colliderMeshes.find(bb->first);
+				if(meshCollision && mesh != colliderMeshes.end() &&
+				   !mesh->second.triangles->empty() &&
+				   !sweepMesh(mesh->second, motion, t)) {
+					continue;
+				}
+				if(t < tHit) {
+					tHit = t;
+					hitId = bb->first;
+				}
+			}
+
+			rocketPosition += motion * tHit;
+			for(auto &coin : coins) {
+				if(coin.first <= tHit) resolveContact(coin.second, rocketPosition);
+			}
+			if(hitId.empty()) break;
+
+			glm::vec3 point;
+			if(contactPoint(hitId, rocketPosition, rocketCollider.radius + CONTACT_SKIN,
+							point)) {
+				resolveContact(hitId, point);
+			}
+			if(rocketState == RESTING) break;
+			dt *= 1.0f - tHit;
+		}
+	}
+
+	/**
+	 * Turn the rocket with the directional keys (WASD)
+	 */
+	void getDirection(const SimInput &input) {
+		float tilt = params.tiltSpeed * DELTA_T;
+		if(input.held(SimInput::W)) {
+			rocketRotation.x -= 1.0f;
+			if(wasGoingUp) {
+				rocketRotVert -= tilt;
+				rocketRotVert = glm::max(rocketRotVert, -params.maxTilt);
+			} else {
+				wasGoingUp = true;
+			}
+		}
+		if(input.held(SimInput::S)) {
+			rocketRotation.x += 1.0f;
+			if(!wasGoingUp) {
+				rocketRotVert += tilt;
+				rocketRotVert = glm::min(rocketRotVert, params.maxTilt);
+			} else {
+				wasGoingUp = false;
+			}
+		}
+		if(input.held(SimInput::A)) {
+			rocketRotation.y += 1.0f;
+			if(!wasGoingRight) {
+				rocketRotHor += tilt;
+				rocketRotHor = glm::min(rocketRotHor, params.maxTilt);
+			} else {
+				wasGoingRight = false;
+			}
+		}
+		if(input.held(SimInput::D)) {
+			rocketRotation.y -= 1.0f;
+			if(wasGoingRight) {
+				rocketRotHor -= tilt;
+				rocketRotHor = glm::max(rocketRotHor, -params.maxTilt);
+			} else {
+				wasGoingRight = true;
+			}
+		}
+	}
+
+	/**
+	 * Turn the camera around the rocket with the arrow keys
+	 */
+	void getCameraControls(const SimInput &input) {
+		if(input.held(SimInput::LEFT)) {
+			rocketCameraRotation.y -= 1.0f;
+		}
+		if(input.held(SimInput::RIGHT)) {
+			rocketCameraRotation.y += 1.0f;
+		}
+		if(input.held(SimInput::UP)) {
+			rocketCameraRotation.x -= 1.0f;
+		}
+		if(input.held(SimInput::DOWN)) {
+			rocketCameraRotation.x += 1.0f;
+		}
+	}
+
+	/**
+	 * Snapshot of what tick() moves and the frame draws
+	 */
+	SimState state() const {
+		return {rocketPosition, rocketRotation, rocketRotHor, rocketRotVert,
+				rocketCameraRotation, coinRot, cTime};
+	}
+
+	/**
+	 * Interpolate a value that wraps around period, taking the short way
+	 */
+	static float mixWrapped(float a, float b, float alpha, float period) {
+		if(b - a > period / 2.0f) b -= period;
+		if(a - b > period / 2.0f) b += period;
+		return glm::mix(a, b, alpha);
+	}
+
+	/**
+	 * State to draw, alpha of the way from the previous tick to the last one
+	 */
+	SimState interpolate(const SimState& prev, const SimState& cur, float alpha) {
+		SimState state;
+		state.rocketPosition = glm::mix(prev.rocketPosition, cur.rocketPosition, alpha);
+		state.rocketRotation = glm::mix(prev.rocketRotation, cur.rocketRotation, alpha);
+		state.rocketRotHor = glm::mix(prev.rocketRotHor, cur.rocketRotHor, alpha);
+		state.rocketRotVert = glm::mix(prev.rocketRotVert, cur.rocketRotVert, alpha);
+		state.cameraRotation = glm::mix(prev.cameraRotation, cur.cameraRotation, alpha);
+		state.coinRot = mixWrapped(prev.coinRot, cur.coinRot, alpha, 360.0f);
+		state.cTime = mixWrapped(prev.cTime, cur.cTime, alpha, TURN_TIME);
+		return state;
+	}
+
+	/**
+	 * World matrix of a coin spinning by rot at location
+	 */
+	glm::mat4 coinWorld(const glm::vec3& location, float rot) {
+		glm::mat4 World = glm::translate(glm::mat4(1.0f), location);
+		World *= glm::rotate(glm::mat4(1.0f), glm::radians(90.0f),
+							 glm::vec3(1.0f, 0.0f, 0.0f));
+		World *= glm::rotate(glm::mat4(1.0f), rot, glm::vec3(0.0f, 0.0f, 1.0f));
+		World *= glm::scale(glm::mat4(1), glm::vec3(0.003f, 0.003f, 0.003f));
+		return World;
+	}
+
+	/**
+	 * Advance the game by DELTA_T: light, coins, rocket and its camera
+	 */
+	void tick(const SimInput &input) {
+		// Automatically rotate ambient light
+		cTime = cTime + DELTA_T;
+		cTime = (cTime > TURN_TIME) ? (cTime - TURN_TIME) : cTime;
+
+		if(input.held(SimInput::X))
+			cTime += LIGHT_ROT_SPEED;
+		if(input.held(SimInput::Z))
+			cTime -= LIGHT_ROT_SPEED;
+
+		// Spin the coins and place their boxes
+		coinRot += COIN_ROT_SPEED * DELTA_T;
+		if(coinRot > 360.0f) coinRot = 0.0f;
+
+		placeObject("coin", coinBounds, nullptr, "coin",
+					coinWorld(coinLocations[coinLocation], coinRot));
+		placeObject("coinCrown", coinCrownBounds, nullptr, "coinCrown",
+					coinWorld(coinCrownLocations[coinCrownLocation], coinRot));
+		placeObject("coinThunder", coinThunderBounds, nullptr, "coinThunder",
+					coinWorld(coinThunderLocations[coinThunderLocation], coinRot));
+
+		// Need to check collisions first, keeping every box touched
+		updateColliders();
+		std::vector<int> candidates;
+		colliders.overlaps(rocketCollider.center - rocketCollider.radius,
+						   rocketCollider.center + rocketCollider.radius, candidates);
+		sortById(candidates);
+		std::vector<std::string> collisionIds;
+		glm::vec3 point;
+		for(int c : candidates) {
+			auto bb = bbMap.find(colliderIds[c]);
+			if(bb != bbMap.end() && contactPoint(bb->first, rocketCollider.center,
+													rocketCollider.radius, point)) {
+				collisionIds.push_back(bb->first);
+			}
+		}
+
+		getDirection(input);
+
+		// Stabilize the rocket in both vertical and horizontal planes
+		float straighten = std::exp(-params.stabilizeRate * DELTA_T);
+		if(rocketRotHor <= -params.stabilizeThreshold ||
+		   rocketRotHor >= params.stabilizeThreshold) {
+			rocketRotHor += wasGoingRight ? straighten : -straighten;
+			// Keep the angle confined to avoid complete turns
+			rocketRotHor = glm::clamp(rocketRotHor, -params.maxTilt, params.maxTilt);
+		}
+		if(rocketRotVert <= -params.stabilizeThreshold ||
+		   rocketRotVert >= params.stabilizeThreshold) {
+			rocketRotVert += wasGoingUp ? straighten : -straighten;
+			rocketRotVert = glm::clamp(rocketRotVert, -params.maxTilt, params.maxTilt);
+		}
+
+		// Gravity while rocket is moving (gravity constant can be lowered)
+		if(rocketState == MOVING) {
+			rocketVerticalSpeed += params.gravity * DELTA_T;
+			// Set terminal fall speed
+			rocketVerticalSpeed = glm::max(rocketVerticalSpeed, 0.1f);
+		}
+
+		if(input.held(SimInput::SPACE)) {
+			rocketDirection.z -= 1.0f;
+
+			glm::mat4 rocketRotationMatrix =
+				glm::rotate(glm::mat4(1.0f), glm::radians(rocketRotation.y),
+							glm::vec3(0.0f, 1.0f, 0.0f));
+			rocketRotationMatrix =
+				glm::rotate(rocketRotationMatrix, glm::radians(rocketRotation.x),
+							glm::vec3(1.0f, 0.0f, 0.0f));
+			glm::vec3 newRocketDirection =
+				glm::vec3(rocketRotationMatrix * glm::vec4(rocketDirection, 0.0f));
+
+			rocketSpeed += newRocketDirection * params.moveSpeed * DELTA_T;
+
+			// Cap maximum speed
+			if(glm::length(rocketSpeed) > 1.0f)
+				rocketSpeed = glm::normalize(rocketSpeed) * 1.0f;
+
+			// Acceleration towards maximum speed
+			rocketState = MOVING;
+			// Reset direction to avoid permanently going in the same direction
+			rocketDirection = {0, 0, 0};
+			// "Cancel" gravity while accelerating
+			rocketVerticalSpeed = 0.0f;
+		}
+
+		for(const std::string &collisionId : collisionIds) {
+			// An earlier contact may have pushed the rocket out already
+			if(!contactPoint(collisionId, rocketPosition, rocketCollider.radius, point)) {
+				continue;
+			}
+			resolveContact(collisionId, point);
+		}
+
+		if(rocketState == RESTING) {
+			rocketPosition = restingPosition;
+		} else {
+			rocketSpeed.y -= rocketVerticalSpeed;
+			rocketSpeed.y = glm::max(rocketSpeed.y, -1.75f);
+			sweepRocket(DELTA_T);
+		}
+
+		// Prevent crazy bugs
+		if(isnan(rocketPosition.x) || isnan(rocketPosition.y) ||
+		   isnan(rocketPosition.z)) {
+			rocketPosition = glm::vec3(-1.0f, 2.0f, 4.0f);
+		}
+		rocketCollider.center = rocketPosition;
+		rocketDirection = glm::vec3(0.0f, 0.0f, 0.0f);
+
+		getCameraControls(input);
+
+		if(rocketCameraRotation.y > 89.0f) rocketCameraRotation.y = 89.0f;
+		if(rocketCameraRotation.y < -89.0f) rocketCameraRotation.y = -89.0f;
+		if(rocketCameraRotation.x < -89.0f) rocketCameraRotation.x = -89.0f;
+		if(rocketCameraRotation.x > 89.0f) rocketCameraRotation.x = 89.0f;
+	}
+};
@@ -1,50 +1,21 @@
 // This has been adapted from the Vulkan tutorial
 
-#include <iostream>
-#include <stdexcept>
-#include <cstdlib>
-#include <vector>
-#include <cstring>
-#include <optional>
-#include <set>
-#include <cstdint>
-#include <algorithm>
-#include <fstream>
-#include <array>
-
-#define GLM_FORCE_RADIANS
-#define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/quaternion.hpp>
-
-#include <chrono>
-
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
-#define TINYGLTF_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#define TINYGLTF_NOEXCEPTION
-#define JSON_NOEXCEPTION
-#define TINYGLTF_NO_INCLUDE_STB_IMAGE
-#include <tiny_gltf.h>
+#include "Assets.hpp"
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
-#include <plusaes.hpp>
-
-#define SINFL_IMPLEMENTATION
-#include <sinfl.h>
-
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+/// Granularity of the host-visible memory staged uploads are carved from
+const VkDeviceSize STAGING_BLOCK_SIZE = 16 * 1024 * 1024;
+/// Staged bytes after which an upload batch is submitted early
+const VkDeviceSize STAGING_BUDGET = 256 * 1024 * 1024;
+/// Stages of the graphics queue that wait for a dedicated transfer queue
+const VkPipelineStageFlags UPLOAD_WAIT_STAGES =
+	VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+
 const std::vector<const char *> validationLayers = {
 	"VK_LAYER_KHRONOS_validation"};
 
@@ -53,6 +24,8 @@ std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	/// transfer-only family, used for uploads when the device has one
+	std::optional<uint32_t> transferFamily;
 
 	bool isComplete() {
 		return graphicsFamily.has_value() && presentFamily.has_value();
@@ -66,15 +39,6 @@ struct SwapChainSupportDetails {
 };
 
 
-enum CollisionType { COLLECTIBLE = 0, OBJECT = 1 };
-
-struct BoundingBox {
-	glm::vec3 min;
-	glm::vec3 max;
-	CollisionType cType;
-};
-
-
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance,
 									  const VkDebugUtilsMessengerCreateInfoEXT *pCreateInfo,
 									  const VkAllocationCallbacks *pAllocator,
@@ -143,22 +107,426 @@ void PrintVkError(VkResult result) {
 }
 
 
-std::vector<char> readFile(const std::string &filename) {
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
-	if(!file.is_open()) {
-		std::cout << "Failed to open: " << filename << "\n";
-		throw std::runtime_error("failed to open file!");
+/// Bump whenever the texture cache builder changes its output
+const uint32_t TEXTURE_CACHE_VERSION = 1;
+
+/**
+ * Encode cached RGBA8 textures as BC1 (opaque) or BC3 (with alpha),
+ * R8 as BC4 and R8G8 as BC5.
+ * Must be set before textures are loaded; devices without BC support
+ * get the blocks decoded back at upload time.
+ */
+bool textureCacheCompression = true;
+
+/**
+ * Header of a texture cache file, a KTX2-like container: followed by
+ * the source path, one TextureCacheLevel per mip level and the texels
+ * of every level (the layers of a level are contiguous)
+ */
+struct TextureCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceTime;
+	uint64_t sourceSize;
+	uint32_t requestedFormat;	// format asked by the application
+	uint32_t format;			// format of the stored texels
+	uint32_t compressed;		// textureCacheCompression when built
+	uint32_t width;
+	uint32_t height;
+	uint32_t layers;
+	uint32_t mipLevels;
+	uint32_t pathLength;
+};
+
+struct TextureCacheLevel {
+	uint64_t offset;	// from the start of the texel data
+	uint64_t size;
+};
+
+/// One cache file per source image and requested format
+std::string textureCachePath(const std::string &file, VkFormat format) {
+	std::string name = file;
+	for(char &c : name) {
+		if(c == '/' || c == '\\' || c == ':') c = '_';
+	}
+	return std::string(ASSET_CACHE_DIR) + "/" + name + "." +
+		   std::to_string((int)format) + ".txc";
+}
+
+bool isBlockCompressed(VkFormat format) {
+	switch(format) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/// Bytes per texel, or per 4x4 block for block-compressed formats
+uint32_t texelBlockSize(VkFormat format) {
+	switch(format) {
+	case VK_FORMAT_R8_UNORM:
+		return 1;
+	case VK_FORMAT_R8G8_UNORM:
+		return 2;
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		return 8;
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return 16;
+	default:
+		return 4;
 	}
+}
 
-	size_t fileSize = (size_t)file.tellg();
-	std::vector<char> buffer(fileSize);
-	// std::cout << filename << " -> " << fileSize << " B\n";
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
+/// Size in bytes of one layer of a width x height image
+size_t imageLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+	if(isBlockCompressed(format)) {
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * texelBlockSize(format);
+	}
+	return (size_t)width * height * texelBlockSize(format);
+}
 
-	file.close();
+float srgbToLinear(unsigned char c) {
+	static const std::array<float, 256> table = []() {
+		std::array<float, 256> t;
+		for(int i = 0; i < 256; i++) {
+			float v = i / 255.0f;
+			t[i] = v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+		}
+		return t;
+	}();
+	return table[c];
+}
 
-	return buffer;
+unsigned char linearToSrgb(float v) {
+	v = std::clamp(v, 0.0f, 1.0f);
+	v = v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+	return (unsigned char)(v * 255.0f + 0.5f);
+}
+
+/**
+ * 2x2 box filter of one layer into the next mip level. With srgb the
+ * first three channels are averaged in linear space, like the GPU blit
+ * of an sRGB image does.
+ */
+void downsampleLevel(const unsigned char *src, uint32_t width, uint32_t height,
+					 int channels, bool srgb, unsigned char *dst) {
+	uint32_t dstWidth = std::max(width / 2, 1u);
+	uint32_t dstHeight = std::max(height / 2, 1u);
+	for(uint32_t y = 0; y < dstHeight; y++) {
+		uint32_t y0 = std::min(2 * y, height - 1);
+		uint32_t y1 = std::min(2 * y + 1, height - 1);
+		for(uint32_t x = 0; x < dstWidth; x++) {
+			uint32_t x0 = std::min(2 * x, width - 1);
+			uint32_t x1 = std::min(2 * x + 1, width - 1);
+			const unsigned char *p[4] = {
+				src + ((size_t)y0 * width + x0) * channels,
+				src + ((size_t)y0 * width + x1) * channels,
+				src + ((size_t)y1 * width + x0) * channels,
+				src + ((size_t)y1 * width + x1) * channels};
+			unsigned char *out = dst + ((size_t)y * dstWidth + x) * channels;
+			for(int c = 0; c < channels; c++) {
+				if(srgb && c < 3) {
+					float sum = srgbToLinear(p[0][c]) + srgbToLinear(p[1][c]) +
+								srgbToLinear(p[2][c]) + srgbToLinear(p[3][c]);
+					out[c] = linearToSrgb(sum * 0.25f);
+				} else {
+					out[c] = (unsigned char)((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4);
+				}
+			}
+		}
+	}
+}
+
+/// Channels stored per texel by an uncompressed or BC format
+int textureChannels(VkFormat format) {
+	switch(format) {
+	case VK_FORMAT_R8_UNORM:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		return 1;
+	case VK_FORMAT_R8G8_UNORM:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+/// Copy the 4x4 block at (bx, by), repeating edge texels
+void fetchBlock(const unsigned char *src, uint32_t width, uint32_t height,
+				int channels, uint32_t bx, uint32_t by, unsigned char block[64]) {
+	for(int y = 0; y < 4; y++) {
+		uint32_t sy = std::min(by * 4 + y, height - 1);
+		for(int x = 0; x < 4; x++) {
+			uint32_t sx = std::min(bx * 4 + x, width - 1);
+			memcpy(block + (y * 4 + x) * channels,
+				   src + ((size_t)sy * width + sx) * channels, channels);
+		}
+	}
+}
+
+uint16_t packRGB565(const float rgb[3]) {
+	int r = (int)(std::clamp(rgb[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+	int g = (int)(std::clamp(rgb[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+	int b = (int)(std::clamp(rgb[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+void unpackRGB565(uint16_t c, int rgb[3]) {
+	int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+/**
+ * BC1 color block: endpoints at the extremes of the block's principal
+ * axis, each texel mapped to the nearest of the four palette colors
+ */
+void encodeBC1Color(const unsigned char block[64], unsigned char out[8]) {
+	float mean[3] = {};
+	for(int i = 0; i < 16; i++) {
+		for(int c = 0; c < 3; c++) mean[c] += block[i * 4 + c] / 16.0f;
+	}
+	float cov[6] = {};
+	for(int i = 0; i < 16; i++) {
+		float d[3] = {block[i * 4] - mean[0], block[i * 4 + 1] - mean[1],
+					  block[i * 4 + 2] - mean[2]};
+		cov[0] += d[0] * d[0];
+		cov[1] += d[0] * d[1];
+		cov[2] += d[0] * d[2];
+		cov[3] += d[1] * d[1];
+		cov[4] += d[1] * d[2];
+		cov[5] += d[2] * d[2];
+	}
+	float axis[3] = {0.577f, 0.577f, 0.577f};
+	for(int it = 0; it < 8; it++) {
+		float v[3] = {cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+					  cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+					  cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+		float len = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		if(len < 1e-6f) break;
+		for(int c = 0; c < 3; c++) axis[c] = v[c] / len;
+	}
+	float minT = 0.0f, maxT = 0.0f;
+	for(int i = 0; i < 16; i++) {
+		float t = 0.0f;
+		for(int c = 0; c < 3; c++) t += (block[i * 4 + c] - mean[c]) * axis[c];
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+	float e0[3], e1[3];
+	for(int c = 0; c < 3; c++) {
+		e0[c] = mean[c] + axis[c] * maxT;
+		e1[c] = mean[c] + axis[c] * minT;
+	}
+	uint16_t c0 = packRGB565(e0), c1 = packRGB565(e1);
+	if(c0 < c1) std::swap(c0, c1);
+
+	uint32_t indices = 0;
+	if(c0 != c1) {
+		int p[4][3];
+		unpackRGB565(c0, p[0]);
+		unpackRGB565(c1, p[1]);
+		for(int c = 0; c < 3; c++) {
+			p[2][c] = (2 * p[0][c] + p[1][c]) / 3;
+			p[3][c] = (p[0][c] + 2 * p[1][c]) / 3;
+		}
+		for(int i = 0; i < 16; i++) {
+			int best = 0, bestDist = INT32_MAX;
+			for(int k = 0; k < 4; k++) {
+				int dist = 0;
+				for(int c = 0; c < 3; c++) {
+					int d = block[i * 4 + c] - p[k][c];
+					dist += d * d;
+				}
+				if(dist < bestDist) {
+					bestDist = dist;
+					best = k;
+				}
+			}
+			indices |= (uint32_t)best << (2 * i);
+		}
+	}
+	out[0] = c0 & 0xFF;
+	out[1] = c0 >> 8;
+	out[2] = c1 & 0xFF;
+	out[3] = c1 >> 8;
+	for(int i = 0; i < 4; i++) out[4 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+/**
+ * Single channel block with 8 interpolated values (the BC3 alpha and
+ * BC4/BC5 channel encoding)
+ * @param stride distance between two texels of the channel in block
+ */
+void encodeBC4Channel(const unsigned char *block, int stride, unsigned char out[8]) {
+	int a0 = 0, a1 = 255;
+	for(int i = 0; i < 16; i++) {
+		a0 = std::max(a0, (int)block[i * stride]);
+		a1 = std::min(a1, (int)block[i * stride]);
+	}
+	uint64_t indices = 0;
+	if(a0 != a1) {
+		int p[8] = {a0, a1};
+		for(int k = 1; k < 7; k++) p[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+		for(int i = 0; i < 16; i++) {
+			int best = 0, bestDist = INT32_MAX;
+			for(int k = 0; k < 8; k++) {
+				int dist = std::abs(block[i * stride] - p[k]);
+				if(dist < bestDist) {
+					bestDist = dist;
+					best = k;
+				}
+			}
+			indices |= (uint64_t)best << (3 * i);
+		}
+	}
+	out[0] = (unsigned char)a0;
+	out[1] = (unsigned char)a1;
+	for(int i = 0; i < 6; i++) out[2 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+void decodeBC1Color(const unsigned char in[8], bool fourColor, unsigned char block[64]) {
+	uint16_t c0 = in[0] | (in[1] << 8), c1 = in[2] | (in[3] << 8);
+	int p[4][4];
+	unpackRGB565(c0, p[0]);
+	unpackRGB565(c1, p[1]);
+	p[0][3] = p[1][3] = p[2][3] = 255;
+	if(fourColor || c0 > c1) {
+		for(int c = 0; c < 3; c++) {
+			p[2][c] = (2 * p[0][c] + p[1][c]) / 3;
+			p[3][c] = (p[0][c] + 2 * p[1][c]) / 3;
+		}
+		p[3][3] = 255;
+	} else {
+		for(int c = 0; c < 3; c++) {
+			p[2][c] = (p[0][c] + p[1][c]) / 2;
+			p[3][c] = 0;
+		}
+		p[3][3] = 0;
+	}
+	uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+	for(int i = 0; i < 16; i++) {
+		int k = (indices >> (2 * i)) & 3;
+		for(int c = 0; c < 4; c++) block[i * 4 + c] = (unsigned char)p[k][c];
+	}
+}
+
+void decodeBC4Channel(const unsigned char in[8], unsigned char *block, int stride) {
+	int p[8] = {in[0], in[1]};
+	if(p[0] > p[1]) {
+		for(int k = 1; k < 7; k++) p[k + 1] = ((7 - k) * p[0] + k * p[1]) / 7;
+	} else {
+		for(int k = 1; k < 5; k++) p[k + 1] = ((5 - k) * p[0] + k * p[1]) / 5;
+		p[6] = 0;
+		p[7] = 255;
+	}
+	uint64_t indices = 0;
+	for(int i = 0; i < 6; i++) indices |= (uint64_t)in[2 + i] << (8 * i);
+	for(int i = 0; i < 16; i++) {
+		block[i * stride] = (unsigned char)p[(indices >> (3 * i)) & 7];
+	}
+}
+
+/**
+ * Encode one layer of texels (with as many channels as the format) as
+ * BC1 (RGB), BC3 (RGBA: BC4-like alpha + BC1 color), BC4 (R) or BC5 (RG)
+ */
+void encodeBCLevel(const unsigned char *src, uint32_t width, uint32_t height,
+				   VkFormat format, unsigned char *dst) {
+	int channels = textureChannels(format);
+	unsigned char block[64];
+	for(uint32_t by = 0; by < (height + 3) / 4; by++) {
+		for(uint32_t bx = 0; bx < (width + 3) / 4; bx++) {
+			fetchBlock(src, width, height, channels, bx, by, block);
+			switch(format) {
+			case VK_FORMAT_BC3_UNORM_BLOCK:
+			case VK_FORMAT_BC3_SRGB_BLOCK:
+				encodeBC4Channel(block + 3, 4, dst);
+				encodeBC1Color(block, dst + 8);
+				break;
+			case VK_FORMAT_BC4_UNORM_BLOCK:
+				encodeBC4Channel(block, 1, dst);
+				break;
+			case VK_FORMAT_BC5_UNORM_BLOCK:
+				encodeBC4Channel(block, 2, dst);
+				encodeBC4Channel(block + 1, 2, dst + 8);
+				break;
+			default:
+				encodeBC1Color(block, dst);
+			}
+			dst += texelBlockSize(format);
+		}
+	}
+}
+
+/// Inverse of encodeBCLevel, for devices without BC support
+void decodeBCLevel(const unsigned char *src, uint32_t width, uint32_t height,
+				   VkFormat format, unsigned char *dst) {
+	int channels = textureChannels(format);
+	unsigned char block[64];
+	for(uint32_t by = 0; by < (height + 3) / 4; by++) {
+		for(uint32_t bx = 0; bx < (width + 3) / 4; bx++) {
+			switch(format) {
+			case VK_FORMAT_BC3_UNORM_BLOCK:
+			case VK_FORMAT_BC3_SRGB_BLOCK:
+				decodeBC1Color(src + 8, true, block);
+				decodeBC4Channel(src, block + 3, 4);
+				break;
+			case VK_FORMAT_BC4_UNORM_BLOCK:
+				decodeBC4Channel(src, block, 1);
+				break;
+			case VK_FORMAT_BC5_UNORM_BLOCK:
+				decodeBC4Channel(src, block, 2);
+				decodeBC4Channel(src + 8, block + 1, 2);
+				break;
+			default:
+				decodeBC1Color(src, false, block);
+			}
+			src += texelBlockSize(format);
+
+			for(uint32_t y = 0; y < 4 && by * 4 + y < height; y++) {
+				for(uint32_t x = 0; x < 4 && bx * 4 + x < width; x++) {
+					memcpy(dst + ((size_t)(by * 4 + y) * width + bx * 4 + x) * channels,
+						   block + (y * 4 + x) * channels, channels);
+				}
+			}
+		}
+	}
+}
+
+VkFormat textureSemanticFormat(TextureSemantic semantic) {
+	switch(semantic) {
+	case ROUGHNESS:
+	case MASK:
+		return VK_FORMAT_R8_UNORM;
+	case METALLIC_ROUGHNESS:
+		return VK_FORMAT_R8G8_UNORM;
+	default:
+		return VK_FORMAT_R8G8B8A8_SRGB;
+	}
 }
 
 class BaseProject;
@@ -187,20 +555,9 @@ struct VertexDescriptorElement {
 	VertexDescriptorElementUsage usage;
 };
 
-struct VertexComponent {
-	bool hasIt;
-	uint32_t offset;
-};
-
-struct VertexDescriptor {
+struct VertexDescriptor : VertexFormat {
 	BaseProject *BP;
 
-	VertexComponent Position;
-	VertexComponent Normal;
-	VertexComponent UV;
-	VertexComponent Color;
-	VertexComponent Tangent;
-
 	std::vector<VertexBindingDescriptorElement> Bindings;
 	std::vector<VertexDescriptorElement> Layout;
 
@@ -212,10 +569,8 @@ struct VertexDescriptor {
 	std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
 };
 
-enum ModelType { OBJ, GLTF, MGCG };
-
 template<class Vert>
-class Model {
+class Model : public Mesh<Vert> {
 	VkBuffer vertexBuffer;
 	VkDeviceMemory vertexBufferMemory;
 	VkBuffer indexBuffer;
@@ -223,19 +578,11 @@ class Model {
 
 public:
 	BaseProject *BP;
-	VertexDescriptor *VD;
-	std::vector<Vert> vertices{};
-	std::vector<uint32_t> indices{};
-	void loadModelOBJ(std::string file, std::string id,
-					  std::unordered_map<std::string, std::vector<glm::vec3>> &vecMap);
-	void loadModelGLTF(std::string file, bool encoded, std::string id,
-					   std::unordered_map<std::string, std::vector<glm::vec3>> &vecMap);
 	void createIndexBuffer();
 	void createVertexBuffer();
 
-	void init(BaseProject *bp, VertexDescriptor *VD, std::string file,
-			  ModelType MT, std::string id,
-			  std::unordered_map<std::string, std::vector<glm::vec3>> &vecMap);
+	void init(BaseProject *bp, VertexDescriptor *VD, std::string file, ModelType MT);
+	void initLoaded(BaseProject *bp);
 	void initMesh(BaseProject *bp, VertexDescriptor *VD);
 	void cleanup();
 	void bind(VkCommandBuffer commandBuffer);
@@ -251,6 +598,29 @@ struct Texture {
 	int imgs;
 	static const int maxImgs = 6;
 
+	/// Decoded images waiting to be uploaded
+	int texWidth;
+	int texHeight;
+	stbi_uc *pixels[maxImgs];
+	std::future<void> loading;
+
+	TextureSemantic semantic = ALBEDO;
+
+	/// Every mip level ready for upload, from the cache or built on load
+	VkFormat requestedFormat = VK_FORMAT_R8G8B8A8_SRGB;
+	VkFormat texelFormat;
+	std::vector<VkDeviceSize> levelOffsets;
+	const unsigned char *texels = nullptr;
+	std::vector<unsigned char> builtTexels;
+	MappedFile cacheFile;
+
+	void loadImages(const char *const files[]);
+	void uploadImages(VkFormat Fmt);
+	void prepareLevels(const char *file, VkFormat Fmt);
+	bool loadCache(const std::string &file, VkFormat Fmt);
+	void buildLevels(VkFormat Fmt);
+	void storeCache(const std::string &file);
+	void uploadLevels();
 	void createTextureImage(const char *const files[], VkFormat Fmt);
 	void createTextureImageView(VkFormat Fmt);
 	void createTextureSampler(VkFilter magFilter, VkFilter minFilter,
@@ -260,8 +630,15 @@ struct Texture {
 							  float maxAnisotropy, float maxLod);
 
 	void init(BaseProject *bp, const char *file, VkFormat Fmt, bool initSampler);
+	void loadAsync(const char *file, VkFormat Fmt);
+	void loadAsync(const char *file, TextureSemantic sem);
+	void initLoaded(BaseProject *bp, bool initSampler);
 	void initCubic(BaseProject *bp, const char *files[6]);
 	void cleanup();
+
+	~Texture() {
+		if(loading.valid()) loading.wait();
+	}
 };
 
 struct DescriptorSetLayoutBinding {
@@ -286,6 +663,8 @@ struct Pipeline {
 
 	VkShaderModule vertShaderModule;
 	VkShaderModule fragShaderModule;
+	std::string VertShader;
+	std::string FragShader;
 	std::vector<DescriptorSetLayout *> D;
 
 	VkCompareOp compareOp;
@@ -300,6 +679,7 @@ struct Pipeline {
 	void setAdvancedFeatures(VkCompareOp _compareOp, VkPolygonMode _polyModel,
 							 VkCullModeFlagBits _CM, bool _transp);
 	void create();
+	bool reload();
 	void destroy();
 	void bind(VkCommandBuffer commandBuffer);
 
@@ -314,6 +694,8 @@ struct DescriptorSetElement {
 	DescriptorSetElementType type;
 	int size;
 	Texture *tex;
+	/// what the shader expects to sample from tex
+	TextureSemantic semantic;
 };
 
 struct DescriptorSet {
@@ -324,6 +706,7 @@ struct DescriptorSet {
 	std::vector<VkDescriptorSet> descriptorSets;
 
 	std::vector<bool> toFree;
+	VkDescriptorPool pool = VK_NULL_HANDLE;
 
 	void init(BaseProject *bp, DescriptorSetLayout *L,
 			  std::vector<DescriptorSetElement> E);
@@ -340,6 +723,8 @@ class BaseProject {
 	friend class Pipeline;
 	friend class DescriptorSetLayout;
 	friend class DescriptorSet;
+	template<class Vert>
+	friend class SceneManager;
 
 public:
 	virtual void setWindowParameters() = 0;
@@ -347,8 +732,15 @@ public:
 		windowResizable = GLFW_FALSE;
 
 		setWindowParameters();
+		localPreload();
 		initWindow();
-		initVulkan();
+		try {
+			initVulkan();
+		} catch(...) {
+			// Asset jobs still reference the application objects
+			loaderPool().waitIdle();
+			throw;
+		}
 		mainLoop();
 		cleanup();
 	}
@@ -363,6 +755,18 @@ protected:
 	int texturesInPool;
 	int setsInPool;
 
+	/**
+	 * Memory used for Model vertex and index buffers. AUTO stages them
+	 * into DEVICE_LOCAL memory on discrete GPUs, and writes them directly
+	 * into HOST_VISIBLE memory on integrated and software devices
+	 */
+	enum GeometryMemory {
+		GEOMETRY_AUTO,
+		GEOMETRY_HOST_VISIBLE,
+		GEOMETRY_DEVICE_LOCAL
+	};
+	GeometryMemory geometryMemory = GEOMETRY_AUTO;
+
 	GLFWwindow *window;
 	VkInstance instance;
 
@@ -372,6 +776,11 @@ protected:
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
 	VkCommandPool commandPool;
+	VkQueue transferQueue = VK_NULL_HANDLE;
+	VkCommandPool transferCommandPool = VK_NULL_HANDLE;
+	uint32_t graphicsFamilyIndex;
+	uint32_t transferFamilyIndex;
+	VkBool32 textureCompressionBC = VK_FALSE;
 	std::vector<VkCommandBuffer> commandBuffers;
 
 	VkSwapchainKHR swapChain;
@@ -382,7 +791,18 @@ protected:
 
 	VkRenderPass renderPass;
 
-	VkDescriptorPool descriptorPool;
+	/// Every pool created since the swap chain, each twice the previous
+	/// one; new descriptor sets come from the first with room for them
+	std::vector<VkDescriptorPool> descriptorPools;
+
+	/// Command buffers to record again before their next submit
+	std::vector<bool> commandBufferStale;
+	/// Destroyed once no command buffer recorded before retire() is left
+	std::vector<std::function<void()>> retiredResources;
+
+	/// .spv files used by the initialized pipelines
+	FileWatcher shaderWatcher;
+	std::unordered_map<std::string, std::vector<Pipeline *>> shaderUsers;
 
 	VkDebugUtilsMessengerEXT debugMessenger;
 
@@ -404,6 +824,37 @@ protected:
 	std::vector<VkFence> inFlightFences;
 	std::vector<VkFence> imagesInFlight;
 
+	/// Host-visible block staged uploads are sub-allocated from
+	struct StagingBlock {
+		VkBuffer buffer;
+		VkDeviceMemory memory;
+		unsigned char *mapped;
+		VkDeviceSize size;
+		VkDeviceSize used;
+	};
+	std::vector<StagingBlock> stagingBlocks;
+	VkDeviceSize stagedBytes = 0;
+	VkCommandBuffer uploadCommandBuffer = VK_NULL_HANDLE;
+	int uploadBatchDepth = 0;
+
+	/**
+	 * Image made shader-readable when the upload batch is submitted,
+	 * after building its mip chain if only level 0 was copied
+	 */
+	struct PendingImage {
+		VkImage image;
+		VkFormat format;
+		int32_t width;
+		int32_t height;
+		uint32_t mipLevels;
+		int layers;
+		bool generateMips;
+	};
+	std::vector<PendingImage> pendingImages;
+	/// Queue family ownership transfers from the transfer queue
+	std::vector<VkBufferMemoryBarrier> pendingBufferTransfers;
+	std::vector<VkImageMemoryBarrier> pendingImageTransfers;
+
 	class VendorID {
 	public:
 		static const uint32_t NVIDIA = 0x10DE;
@@ -433,6 +884,12 @@ protected:
 	}
 
 
+	/**
+	 * Called before the window and the Vulkan device are created:
+	 * start CPU-side asset decoding here so that it overlaps
+	 * with initVulkan()
+	 */
+	virtual void localPreload() {}
 	virtual void localInit() = 0;
 	virtual void pipelinesAndDescriptorSetsInit() = 0;
 
@@ -451,7 +908,10 @@ protected:
 		createFramebuffers();
 		createDescriptorPool();
 
+		// every staged copy issued while loading goes out in one submit
+		beginUploadBatch();
 		localInit();
+		endUploadBatch();
 		pipelinesAndDescriptorSetsInit();
 
 		createCommandBuffers();
@@ -712,6 +1172,17 @@ protected:
 		if(physicalDevice == VK_NULL_HANDLE) {
 			throw std::runtime_error("failed to find a suitable GPU!");
 		}
+
+		if(geometryMemory == GEOMETRY_AUTO) {
+			vkGetPhysicalDeviceProperties(physicalDevice, &prop);
+			geometryMemory = (prop.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+								 ? GEOMETRY_DEVICE_LOCAL
+								 : GEOMETRY_HOST_VISIBLE;
+		}
+		std::cout << "Geometry memory: "
+				  << (geometryMemory == GEOMETRY_DEVICE_LOCAL ? "device local"
+															  : "host visible")
+				  << "\n";
 	}
 
 	bool isDeviceSuitable(VkPhysicalDevice device, deviceReport &devRep) {
@@ -751,18 +1222,23 @@ protected:
 
 		int i = 0;
 		for(const auto &queueFamily : queueFamilies) {
-			if(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-				indices.graphicsFamily = i;
-			}
+			if(!indices.isComplete()) {
+				if(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+					indices.graphicsFamily = i;
+				}
 
-			VkBool32 presentSupport = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-			if(presentSupport) {
-				indices.presentFamily = i;
+				VkBool32 presentSupport = false;
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+				if(presentSupport) {
+					indices.presentFamily = i;
+				}
 			}
 
-			if(indices.isComplete()) {
-				break;
+			if(!indices.transferFamily.has_value() &&
+			   (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+			   !(queueFamily.queueFlags &
+				 (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+				indices.transferFamily = i;
 			}
 			i++;
 		}
@@ -852,6 +1328,9 @@ protected:
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 		std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(),
 												  indices.presentFamily.value()};
+		if(indices.transferFamily.has_value()) {
+			uniqueQueueFamilies.insert(indices.transferFamily.value());
+		}
 
 		float queuePriority = 1.0f;
 		for(uint32_t queueFamily : uniqueQueueFamilies) {
@@ -863,9 +1342,14 @@ protected:
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+		textureCompressionBC = supportedFeatures.textureCompressionBC;
+
 		VkPhysicalDeviceFeatures deviceFeatures{};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
 		deviceFeatures.sampleRateShading = VK_TRUE;
+		deviceFeatures.textureCompressionBC = textureCompressionBC;
 
 		VkDeviceCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -893,6 +1377,14 @@ protected:
 
 		vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
 		vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+		graphicsFamilyIndex = indices.graphicsFamily.value();
+		if(indices.transferFamily.has_value()) {
+			transferFamilyIndex = indices.transferFamily.value();
+			vkGetDeviceQueue(device, transferFamilyIndex, 0, &transferQueue);
+			std::cout << "Using dedicated transfer queue family "
+					  << transferFamilyIndex << "\n";
+		}
 	}
 
 	void createSwapChain() {
@@ -1141,7 +1633,8 @@ protected:
 		VkCommandPoolCreateInfo poolInfo{};
 		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 		poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-		poolInfo.flags = 0;	 // Optional
+		// command buffers are recorded again when the scene changes
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
 		VkResult result =
 			vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool);
@@ -1149,6 +1642,17 @@ protected:
 			PrintVkError(result);
 			throw std::runtime_error("failed to create command pool!");
 		}
+
+		if(transferQueue != VK_NULL_HANDLE) {
+			poolInfo.queueFamilyIndex = transferFamilyIndex;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			result = vkCreateCommandPool(device, &poolInfo, nullptr,
+										 &transferCommandPool);
+			if(result != VK_SUCCESS) {
+				PrintVkError(result);
+				throw std::runtime_error("failed to create transfer command pool!");
+			}
+		}
 	}
 
 	void createColorResources() {
@@ -1253,6 +1757,19 @@ protected:
 
 	void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth,
 						 int32_t texHeight, uint32_t mipLevels, int layerCount) {
+		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		recordMipmaps(commandBuffer, image, imageFormat, texWidth, texHeight,
+					  mipLevels, layerCount);
+		endSingleTimeCommands(commandBuffer);
+	}
+
+	/**
+	 * Record the blits filling levels 1..mipLevels-1 from level 0 (all in
+	 * TRANSFER_DST_OPTIMAL), leaving the image in SHADER_READ_ONLY_OPTIMAL
+	 */
+	void recordMipmaps(VkCommandBuffer commandBuffer, VkImage image,
+					   VkFormat imageFormat, int32_t texWidth, int32_t texHeight,
+					   uint32_t mipLevels, int layerCount) {
 		VkFormatProperties formatProperties;
 		vkGetPhysicalDeviceFormatProperties(physicalDevice, imageFormat,
 											&formatProperties);
@@ -1263,8 +1780,6 @@ protected:
 				"texture image format does not support linear blitting!");
 		}
 
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
 		VkImageMemoryBarrier barrier{};
 		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 		barrier.image = image;
@@ -1328,8 +1843,6 @@ protected:
 		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
 							 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
 							 nullptr, 0, nullptr, 1, &barrier);
-
-		endSingleTimeCommands(commandBuffer);
 	}
 
 	void transitionImageLayout(VkImage image, VkFormat format,
@@ -1413,10 +1926,14 @@ protected:
 	}
 
 	VkCommandBuffer beginSingleTimeCommands() {
+		return beginSingleTimeCommands(commandPool);
+	}
+
+	VkCommandBuffer beginSingleTimeCommands(VkCommandPool pool) {
 		VkCommandBufferAllocateInfo allocInfo{};
 		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandPool = commandPool;
+		allocInfo.commandPool = pool;
 		allocInfo.commandBufferCount = 1;
 
 		VkCommandBuffer commandBuffer;
@@ -1478,6 +1995,320 @@ protected:
 		vkBindBufferMemory(device, buffer, bufferMemory, 0);
 	}
 
+	/**
+	 * Start collecting staged copies into a single command buffer.
+	 * Batches nest: only the outermost endUploadBatch() submits.
+	 */
+	void beginUploadBatch() {
+		if(uploadBatchDepth++ == 0) {
+			uploadCommandBuffer = beginSingleTimeCommands(
+				transferQueue != VK_NULL_HANDLE ? transferCommandPool : commandPool);
+		}
+	}
+
+	/// Submit the outermost batch and wait for it
+	void endUploadBatch() {
+		if(--uploadBatchDepth > 0) {
+			return;
+		}
+		submitUploads();
+		uploadCommandBuffer = VK_NULL_HANDLE;
+	}
+
+	/**
+	 * Submit everything recorded in the batch behind one fence, wait for
+	 * it and release the staging memory.
+	 * With a dedicated transfer queue the copies run there and the
+	 * graphics queue takes ownership of the resources, then builds the
+	 * mip chains; otherwise a single command buffer does both.
+	 */
+	void submitUploads() {
+		bool dedicated = transferQueue != VK_NULL_HANDLE;
+		VkCommandBuffer finishCommandBuffer = uploadCommandBuffer;
+
+		if(dedicated) {
+			for(auto &b : pendingBufferTransfers) {
+				b.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				b.dstAccessMask = 0;
+			}
+			for(auto &b : pendingImageTransfers) {
+				b.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				b.dstAccessMask = 0;
+			}
+			if(!pendingBufferTransfers.empty() || !pendingImageTransfers.empty()) {
+				vkCmdPipelineBarrier(
+					uploadCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+					VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+					static_cast<uint32_t>(pendingBufferTransfers.size()),
+					pendingBufferTransfers.data(),
+					static_cast<uint32_t>(pendingImageTransfers.size()),
+					pendingImageTransfers.data());
+			}
+			vkEndCommandBuffer(uploadCommandBuffer);
+
+			finishCommandBuffer = beginSingleTimeCommands();
+			for(auto &b : pendingBufferTransfers) {
+				b.srcAccessMask = 0;
+				b.dstAccessMask =
+					VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+			}
+			for(auto &b : pendingImageTransfers) {
+				b.srcAccessMask = 0;
+				b.dstAccessMask =
+					VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+			}
+			if(!pendingBufferTransfers.empty() || !pendingImageTransfers.empty()) {
+				vkCmdPipelineBarrier(
+					finishCommandBuffer, UPLOAD_WAIT_STAGES, UPLOAD_WAIT_STAGES, 0, 0,
+					nullptr, static_cast<uint32_t>(pendingBufferTransfers.size()),
+					pendingBufferTransfers.data(),
+					static_cast<uint32_t>(pendingImageTransfers.size()),
+					pendingImageTransfers.data());
+			}
+		} else {
+			// make the copied geometry visible to the vertex input stage
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask =
+				VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+			vkCmdPipelineBarrier(uploadCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+								 VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier,
+								 0, nullptr, 0, nullptr);
+		}
+
+		for(const auto &m : pendingImages) {
+			if(m.generateMips) {
+				recordMipmaps(finishCommandBuffer, m.image, m.format, m.width,
+							  m.height, m.mipLevels, m.layers);
+				continue;
+			}
+
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = m.image;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.baseMipLevel = 0;
+			barrier.subresourceRange.levelCount = m.mipLevels;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = m.layers;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(finishCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+								 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
+								 nullptr, 0, nullptr, 1, &barrier);
+		}
+		vkEndCommandBuffer(finishCommandBuffer);
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		VkFence fence;
+		VkResult result = vkCreateFence(device, &fenceInfo, nullptr, &fence);
+		if(result != VK_SUCCESS) {
+			PrintVkError(result);
+			throw std::runtime_error("failed to create upload fence!");
+		}
+
+		VkSemaphore transferDone = VK_NULL_HANDLE;
+		VkPipelineStageFlags waitStages = UPLOAD_WAIT_STAGES;
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		if(dedicated) {
+			VkSemaphoreCreateInfo semaphoreInfo{};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &transferDone);
+
+			submitInfo.pCommandBuffers = &uploadCommandBuffer;
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = &transferDone;
+			result = vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
+			if(result != VK_SUCCESS) {
+				PrintVkError(result);
+				throw std::runtime_error("failed to submit upload batch!");
+			}
+
+			submitInfo.signalSemaphoreCount = 0;
+			submitInfo.pSignalSemaphores = nullptr;
+			submitInfo.waitSemaphoreCount = 1;
+			submitInfo.pWaitSemaphores = &transferDone;
+			submitInfo.pWaitDstStageMask = &waitStages;
+		}
+		submitInfo.pCommandBuffers = &finishCommandBuffer;
+		result = vkQueueSubmit(graphicsQueue, 1, &submitInfo, fence);
+		if(result != VK_SUCCESS) {
+			PrintVkError(result);
+			throw std::runtime_error("failed to submit upload batch!");
+		}
+		vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+		vkDestroyFence(device, fence, nullptr);
+
+		if(dedicated) {
+			vkDestroySemaphore(device, transferDone, nullptr);
+			vkFreeCommandBuffers(device, transferCommandPool, 1, &uploadCommandBuffer);
+		}
+		vkFreeCommandBuffers(device, commandPool, 1, &finishCommandBuffer);
+
+		for(auto &block : stagingBlocks) {
+			vkUnmapMemory(device, block.memory);
+			vkDestroyBuffer(device, block.buffer, nullptr);
+			vkFreeMemory(device, block.memory, nullptr);
+		}
+		stagingBlocks.clear();
+		stagedBytes = 0;
+		pendingImages.clear();
+		pendingBufferTransfers.clear();
+		pendingImageTransfers.clear();
+	}
+
+	/**
+	 * Reserve size bytes of mapped staging memory in the current batch.
+	 * If the batch already holds STAGING_BUDGET bytes it is submitted
+	 * first, and recording continues in a new command buffer.
+	 * @param buffer set to the staging buffer holding the reservation
+	 * @param offset set to the offset of the reservation in buffer
+	 * @return pointer to write the data to
+	 */
+	unsigned char *stageUpload(VkDeviceSize size, VkBuffer &buffer,
+							   VkDeviceSize &offset) {
+		const VkDeviceSize align = 16;
+		if(stagedBytes > 0 && stagedBytes + size > STAGING_BUDGET) {
+			submitUploads();
+			uploadCommandBuffer = beginSingleTimeCommands(
+				transferQueue != VK_NULL_HANDLE ? transferCommandPool : commandPool);
+		}
+		stagedBytes += size;
+
+		if(stagingBlocks.empty() ||
+		   stagingBlocks.back().used + size > stagingBlocks.back().size) {
+			StagingBlock block{};
+			block.size = std::max(size, STAGING_BLOCK_SIZE);
+			createBuffer(block.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+						 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+							 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+						 block.buffer, block.memory);
+			void *data;
+			vkMapMemory(device, block.memory, 0, block.size, 0, &data);
+			block.mapped = static_cast<unsigned char *>(data);
+			stagingBlocks.push_back(block);
+		}
+
+		StagingBlock &block = stagingBlocks.back();
+		buffer = block.buffer;
+		offset = block.used;
+		block.used = std::min(block.size, (block.used + size + align - 1) / align * align);
+		return block.mapped + offset;
+	}
+
+	/**
+	 * Create a vertex or index buffer filled with size bytes from src,
+	 * in the memory selected by geometryMemory. Device-local buffers are
+	 * copied within the current upload batch (or a batch of their own if
+	 * none is open).
+	 */
+	void createGeometryBuffer(const void *src, VkDeviceSize size,
+							  VkBufferUsageFlags usage, VkBuffer &buffer,
+							  VkDeviceMemory &bufferMemory) {
+		if(geometryMemory != GEOMETRY_DEVICE_LOCAL) {
+			createBuffer(size, usage,
+						 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+							 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+						 buffer, bufferMemory);
+
+			void *data;
+			vkMapMemory(device, bufferMemory, 0, size, 0, &data);
+			memcpy(data, src, (size_t)size);
+			vkUnmapMemory(device, bufferMemory);
+			return;
+		}
+
+		createBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+					 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
+
+		beginUploadBatch();
+		VkBuffer staging;
+		VkDeviceSize offset;
+		memcpy(stageUpload(size, staging, offset), src, (size_t)size);
+
+		VkBufferCopy region{};
+		region.srcOffset = offset;
+		region.dstOffset = 0;
+		region.size = size;
+		vkCmdCopyBuffer(uploadCommandBuffer, staging, buffer, 1, &region);
+
+		if(transferQueue != VK_NULL_HANDLE) {
+			VkBufferMemoryBarrier transfer{};
+			transfer.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			transfer.srcQueueFamilyIndex = transferFamilyIndex;
+			transfer.dstQueueFamilyIndex = graphicsFamilyIndex;
+			transfer.buffer = buffer;
+			transfer.offset = 0;
+			transfer.size = VK_WHOLE_SIZE;
+			pendingBufferTransfers.push_back(transfer);
+		}
+		endUploadBatch();
+	}
+
+	/**
+	 * Record the copy of a staged image into all its layers. The image is
+	 * moved to SHADER_READ_ONLY_OPTIMAL when the batch is submitted.
+	 * @param levelOffsets offset of every mip level from offset; if null
+	 * only level 0 is copied and the others are blitted from it
+	 */
+	void recordImageUpload(VkBuffer staging, VkDeviceSize offset, VkImage image,
+						   VkFormat format, uint32_t width, uint32_t height,
+						   uint32_t mipLevels, int layerCount,
+						   const VkDeviceSize *levelOffsets = nullptr) {
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = mipLevels;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = layerCount;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(uploadCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+							 VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+							 nullptr, 1, &barrier);
+
+		uint32_t copiedLevels = levelOffsets ? mipLevels : 1;
+		std::vector<VkBufferImageCopy> regions(copiedLevels);
+		for(uint32_t i = 0; i < copiedLevels; i++) {
+			VkBufferImageCopy &region = regions[i];
+			region.bufferOffset = offset + (levelOffsets ? levelOffsets[i] : 0);
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = i;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = layerCount;
+			region.imageOffset = {0, 0, 0};
+			region.imageExtent = {std::max(width >> i, 1u), std::max(height >> i, 1u), 1};
+		}
+		vkCmdCopyBufferToImage(uploadCommandBuffer, staging, image,
+							   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+							   copiedLevels, regions.data());
+
+		if(transferQueue != VK_NULL_HANDLE) {
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcQueueFamilyIndex = transferFamilyIndex;
+			barrier.dstQueueFamilyIndex = graphicsFamilyIndex;
+			pendingImageTransfers.push_back(barrier);
+		}
+		pendingImages.push_back({image, format, (int32_t)width, (int32_t)height,
+								 mipLevels, layerCount, levelOffsets == nullptr});
+	}
+
 	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
 		VkPhysicalDeviceMemoryProperties memProperties;
 		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
@@ -1493,28 +2324,67 @@ protected:
 	}
 
 	void createDescriptorPool() {
+		addDescriptorPool();
+	}
+
+	/**
+	 * Create one more descriptor pool, sized from the *InPool counts
+	 * times 2^(number of pools already created)
+	 */
+	void addDescriptorPool() {
+		uint32_t scale = 1u << std::min<size_t>(descriptorPools.size(), 16);
+		uint32_t images = static_cast<uint32_t>(swapChainImages.size());
+
 		std::array<VkDescriptorPoolSize, 2> poolSizes{};
 		poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 		poolSizes[0].descriptorCount =
-			static_cast<uint32_t>(uniformBlocksInPool * swapChainImages.size());
+			std::max(uniformBlocksInPool, 1) * images * scale;
 		poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		poolSizes[1].descriptorCount =
-			static_cast<uint32_t>(texturesInPool * swapChainImages.size());
+		poolSizes[1].descriptorCount = std::max(texturesInPool, 1) * images * scale;
 
 		VkDescriptorPoolCreateInfo poolInfo{};
 		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		// sets of despawned instances are given back one by one
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
 		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-		;
 		poolInfo.pPoolSizes = poolSizes.data();
-		poolInfo.maxSets =
-			static_cast<uint32_t>(setsInPool * swapChainImages.size());
+		poolInfo.maxSets = std::max(setsInPool, 1) * images * scale;
 
-		VkResult result =
-			vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool);
+		VkDescriptorPool pool;
+		VkResult result = vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool);
 		if(result != VK_SUCCESS) {
 			PrintVkError(result);
 			throw std::runtime_error("failed to create descriptor pool!");
 		}
+		descriptorPools.push_back(pool);
+	}
+
+	/**
+	 * Allocate one set per layout from the first pool with room for them,
+	 * so that sets freed by despawned instances are reused, adding a pool
+	 * only when every one is exhausted
+	 * @return the pool the sets have to be freed to
+	 */
+	VkDescriptorPool allocateDescriptorSets(const std::vector<VkDescriptorSetLayout> &layouts,
+											std::vector<VkDescriptorSet> &sets) {
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+		allocInfo.pSetLayouts = layouts.data();
+		sets.resize(layouts.size());
+
+		for(size_t p = 0;; p++) {
+			bool added = p == descriptorPools.size();
+			if(added) addDescriptorPool();
+			allocInfo.descriptorPool = descriptorPools[p];
+			VkResult result = vkAllocateDescriptorSets(device, &allocInfo, sets.data());
+			if(result == VK_SUCCESS) return descriptorPools[p];
+			if(added || (result != VK_ERROR_OUT_OF_POOL_MEMORY &&
+						 result != VK_ERROR_FRAGMENTED_POOL)) {
+				PrintVkError(result);
+				throw std::runtime_error("failed to allocate descriptor sets!");
+			}
+		}
 	}
 
 	virtual void populateCommandBuffer(VkCommandBuffer commandBuffer, int i) = 0;
@@ -1536,44 +2406,114 @@ protected:
 		}
 
 		for(size_t i = 0; i < commandBuffers.size(); i++) {
-			VkCommandBufferBeginInfo beginInfo{};
-			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			beginInfo.flags = 0;				   // Optional
-			beginInfo.pInheritanceInfo = nullptr;  // Optional
+			recordCommandBuffer(i);
+		}
+		commandBufferStale.assign(commandBuffers.size(), false);
+	}
 
-			if(vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-				throw std::runtime_error(
-					"failed to begin recording command buffer!");
-			}
+	void recordCommandBuffer(size_t i) {
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = 0;				   // Optional
+		beginInfo.pInheritanceInfo = nullptr;  // Optional
+
+		if(vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error(
+				"failed to begin recording command buffer!");
+		}
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = renderPass;
+		renderPassInfo.framebuffer = swapChainFramebuffers[i];
+		renderPassInfo.renderArea.offset = {0, 0};
+		renderPassInfo.renderArea.extent = swapChainExtent;
 
-			VkRenderPassBeginInfo renderPassInfo{};
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			renderPassInfo.renderPass = renderPass;
-			renderPassInfo.framebuffer = swapChainFramebuffers[i];
-			renderPassInfo.renderArea.offset = {0, 0};
-			renderPassInfo.renderArea.extent = swapChainExtent;
+		std::array<VkClearValue, 2> clearValues{};
+		clearValues[0].color = initialBackgroundColor;
+		clearValues[1].depthStencil = {1.0f, 0};
 
-			std::array<VkClearValue, 2> clearValues{};
-			clearValues[0].color = initialBackgroundColor;
-			clearValues[1].depthStencil = {1.0f, 0};
+		renderPassInfo.clearValueCount =
+			static_cast<uint32_t>(clearValues.size());
+		renderPassInfo.pClearValues = clearValues.data();
 
-			renderPassInfo.clearValueCount =
-				static_cast<uint32_t>(clearValues.size());
-			renderPassInfo.pClearValues = clearValues.data();
+		vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo,
+							 VK_SUBPASS_CONTENTS_INLINE);
 
-			vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo,
-								 VK_SUBPASS_CONTENTS_INLINE);
 
+		populateCommandBuffer(commandBuffers[i], i);
 
-			populateCommandBuffer(commandBuffers[i], i);
 
+		vkCmdEndRenderPass(commandBuffers[i]);
 
-			vkCmdEndRenderPass(commandBuffers[i]);
+		if(vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record command buffer!");
+		}
+	}
+
+	/**
+	 * Have populateCommandBuffer() called again for every swap chain
+	 * image, each one just before it is next drawn
+	 */
+	void invalidateCommandBuffers() {
+		commandBufferStale.assign(commandBuffers.size(), true);
+	}
 
-			if(vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-				throw std::runtime_error("failed to record command buffer!");
+	/**
+	 * Destroy resources the recorded command buffers may still use,
+	 * once all of them have been recorded again and have completed
+	 */
+	void retire(std::function<void()> destroy) {
+		retiredResources.push_back(std::move(destroy));
+		invalidateCommandBuffers();
+	}
+
+	void destroyRetiredResources() {
+		for(auto &destroy : retiredResources) destroy();
+		retiredResources.clear();
+	}
+
+	void watchShader(Pipeline *P, const std::string &file) {
+		std::vector<Pipeline *> &users = shaderUsers[FileWatcher::key(file)];
+		if(std::find(users.begin(), users.end(), P) == users.end()) {
+			users.push_back(P);
+		}
+		shaderWatcher.watch(file);
+	}
+
+	void unwatchShaders(Pipeline *P) {
+		for(auto &users : shaderUsers) {
+			users.second.erase(std::remove(users.second.begin(), users.second.end(), P),
+							   users.second.end());
+		}
+	}
+
+	/**
+	 * Rebuild the pipelines using a recompiled shader. The old ones are
+	 * retired, so the command buffers get recorded again as their
+	 * images come back instead of waiting for the device
+	 */
+	void reloadShaders() {
+		std::vector<Pipeline *> affected;
+		for(auto &file : shaderWatcher.poll()) {
+			std::cout << "Shader <" << file << "> changed\n";
+			for(Pipeline *P : shaderUsers[file]) {
+				if(std::find(affected.begin(), affected.end(), P) == affected.end()) {
+					affected.push_back(P);
+				}
 			}
 		}
+		if(affected.empty()) return;
+
+		auto start = std::chrono::steady_clock::now();
+		int rebuilt = 0;
+		for(Pipeline *P : affected) {
+			if(P->reload()) rebuilt++;
+		}
+		std::cout << rebuilt << " of " << affected.size() << " pipelines rebuilt in "
+				  << std::chrono::duration<float, std::milli>(
+						 std::chrono::steady_clock::now() - start).count()
+				  << "ms\n";
 	}
 
 	void createSyncObjects() {
@@ -1616,6 +2556,8 @@ protected:
 	}
 
 	void drawFrame() {
+		reloadShaders();
+
 		vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
 		uint32_t imageIndex;
@@ -1636,6 +2578,18 @@ protected:
 		}
 		imagesInFlight[imageIndex] = inFlightFences[currentFrame];
 
+		// The previous use of this image's command buffer has completed
+		if(commandBufferStale[imageIndex]) {
+			recordCommandBuffer(imageIndex);
+			commandBufferStale[imageIndex] = false;
+
+			if(!retiredResources.empty() &&
+			   std::none_of(commandBufferStale.begin(), commandBufferStale.end(),
+							[](bool stale) { return stale; })) {
+				destroyRetiredResources();
+			}
+		}
+
 		updateUniformBuffer(imageIndex);
 
 		VkSubmitInfo submitInfo{};
@@ -1697,6 +2651,7 @@ protected:
 		}
 
 		vkDeviceWaitIdle(device);
+		destroyRetiredResources();
 
 		cleanupSwapChain();
 
@@ -1740,10 +2695,14 @@ protected:
 
 		vkDestroySwapchainKHR(device, swapChain, nullptr);
 
-		vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+		for(VkDescriptorPool pool : descriptorPools) {
+			vkDestroyDescriptorPool(device, pool, nullptr);
+		}
+		descriptorPools.clear();
 	}
 
 	void cleanup() {
+		destroyRetiredResources();
 		cleanupSwapChain();
 
 		localCleanup();
@@ -1755,6 +2714,9 @@ protected:
 		}
 
 		vkDestroyCommandPool(device, commandPool, nullptr);
+		if(transferCommandPool != VK_NULL_HANDLE) {
+			vkDestroyCommandPool(device, transferCommandPool, nullptr);
+		}
 
 		vkDestroyDevice(device, nullptr);
 
@@ -1932,6 +2894,7 @@ void VertexDescriptor::init(BaseProject *bp,
 
 	if(B.size() == 1) {	 // for now, read models only with every vertex
 						 // information in a single binding
+		stride = B[0].stride;
 		for(int i = 0; i < E.size(); i++) {
 			switch(E[i].usage) {
 				case VertexDescriptorElementUsage::POSITION:
@@ -2001,6 +2964,8 @@ void VertexDescriptor::init(BaseProject *bp,
 		throw std::runtime_error(
 			"Vertex format with more than one binding is not supported yet\n");
 	}
+
+	hash = hashLayout();
 }
 
 void VertexDescriptor::cleanup() {}
@@ -2029,344 +2994,51 @@ std::vector<VkVertexInputAttributeDescription> VertexDescriptor::getAttributeDes
 	return attributeDescriptions;
 }
 
-
-template<class Vert>
-void Model<Vert>::loadModelOBJ(std::string file, std::string id,
-							   std::unordered_map<std::string, std::vector<glm::vec3>> &vecMap) {
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string warn, err;
-
-	std::cout << "Loading : " << file << "[OBJ]\n";
-	if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, file.c_str())) {
-		throw std::runtime_error(warn + err);
-	}
-
-	std::cout << "Building\n";
-	for(const auto &shape : shapes) {
-		for(const auto &index : shape.mesh.indices) {
-			Vert vertex{};
-			glm::vec3 pos = {attrib.vertices[3 * index.vertex_index + 0],
-							 attrib.vertices[3 * index.vertex_index + 1],
-							 attrib.vertices[3 * index.vertex_index + 2]};
-			if(VD->Position.hasIt) {
-				glm::vec3 *o = (glm::vec3 *)((char *)(&vertex) + VD->Position.offset);
-				*o = pos;
-			}
-
-			glm::vec3 color = {attrib.colors[3 * index.vertex_index + 0],
-							   attrib.colors[3 * index.vertex_index + 1],
-							   attrib.colors[3 * index.vertex_index + 2]};
-			if(VD->Color.hasIt) {
-				glm::vec3 *o = (glm::vec3 *)((char *)(&vertex) + VD->Color.offset);
-				*o = color;
-			}
-
-			glm::vec2 texCoord = {attrib.texcoords[2 * index.texcoord_index + 0],
-								  1 - attrib.texcoords[2 * index.texcoord_index + 1]};
-			if(VD->UV.hasIt) {
-				glm::vec2 *o = (glm::vec2 *)((char *)(&vertex) + VD->UV.offset);
-				*o = texCoord;
-			}
-
-			glm::vec3 norm = {attrib.normals[3 * index.normal_index + 0],
-							  attrib.normals[3 * index.normal_index + 1],
-							  attrib.normals[3 * index.normal_index + 2]};
-			if(VD->Normal.hasIt) {
-				glm::vec3 *o = (glm::vec3 *)((char *)(&vertex) + VD->Normal.offset);
-				*o = norm;
-			}
-
-			vertices.push_back(vertex);
-			indices.push_back(vertices.size() - 1);
-		}
-	}
-	std::cout << "[OBJ] Vertices: " << vertices.size() << "\n";
-	std::cout << "Indices: " << indices.size() << "\n";
-
-	std::vector<glm::vec3> itemVertices;
-	// Derive bounding box
-	for(const auto &shape : shapes) {
-		for(const auto &i : shape.mesh.indices) {
-			glm::vec3 vertex = glm::vec3(attrib.vertices[3 * i.vertex_index + 0],
-										 attrib.vertices[3 * i.vertex_index + 1],
-										 attrib.vertices[3 * i.vertex_index + 2]);
-			itemVertices.push_back(vertex);
-		}
-		vecMap[id] = itemVertices;
-	}
-}
-
-template<class Vert>
-void Model<Vert>::loadModelGLTF(std::string file, bool encoded, std::string id,
-								std::unordered_map<std::string, std::vector<glm::vec3>> &vecMap) {
-	tinygltf::Model model;
-	tinygltf::TinyGLTF loader;
-	std::string warn, err;
-
-	std::cout << "Loading : " << file << (encoded ? "[MGCG]" : "[GLTF]") << "\n";
-	if(encoded) {
-		auto modelString = readFile(file);
-
-		const std::vector<unsigned char> key =
-			plusaes::key_from_string(&"CG2023SkelKey128");	// 16-char = 128-bit
-		const unsigned char iv[16] = {
-			0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
-			0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
-		};
-
-		// decrypt
-		unsigned long padded_size = 0;
-		std::vector<unsigned char> decrypted(modelString.size());
-
-		plusaes::decrypt_cbc((unsigned char *)modelString.data(),
-							 modelString.size(), &key[0], key.size(), &iv,
-							 &decrypted[0], decrypted.size(), &padded_size);
-
-		int size = 0;
-		void *decomp;
-
-		sscanf(reinterpret_cast<char *const>(&decrypted[0]), "%d", &size);
-
-		decomp = calloc(size, 1);
-		int n = sinflate(decomp, (int)size, &decrypted[16], decrypted.size() - 16);
-
-		if(!loader.LoadASCIIFromString(&model, &warn, &err,
-									   reinterpret_cast<const char *>(decomp),
-									   size, "/")) {
-			throw std::runtime_error(warn + err);
-		}
-	} else {
-		if(!loader.LoadASCIIFromFile(&model, &warn, &err, file.c_str())) {
-			throw std::runtime_error(warn + err);
-		}
-	}
-
-	for(const auto &mesh : model.meshes) {
-		std::cout << "\tPrimitives: " << mesh.primitives.size() << "\n";
-		for(const auto &primitive : mesh.primitives) {
-			if(primitive.indices < 0) {
-				continue;
-			}
-
-			const float *bufferPos = nullptr;
-			const float *bufferNormals = nullptr;
-			const float *bufferTangents = nullptr;
-			const float *bufferTexCoords = nullptr;
-
-			bool meshHasPos = false;
-			bool meshHasNorm = false;
-			bool meshHasTan = false;
-			bool meshHasUV = false;
-
-			int cntPos = 0;
-			int cntNorm = 0;
-			int cntTan = 0;
-			int cntUV = 0;
-			int cntTot = 0;
-
-			auto pIt = primitive.attributes.find("POSITION");
-			if(pIt != primitive.attributes.end()) {
-				const tinygltf::Accessor &posAccessor = model.accessors[pIt->second];
-				const tinygltf::BufferView &posView =
-					model.bufferViews[posAccessor.bufferView];
-				bufferPos = reinterpret_cast<const float *>(
-					&(model.buffers[posView.buffer]
-						  .data[posAccessor.byteOffset + posView.byteOffset]));
-				meshHasPos = true;
-				cntPos = posAccessor.count;
-				if(cntPos > cntTot) cntTot = cntPos;
-			} else {
-				if(VD->Position.hasIt) {
-					std::cout << "Warning: vertex layout has position, but "
-								 "file hasn't\n";
-				}
-			}
-
-			auto nIt = primitive.attributes.find("NORMAL");
-			if(nIt != primitive.attributes.end()) {
-				const tinygltf::Accessor &normAccessor = model.accessors[nIt->second];
-				const tinygltf::BufferView &normView =
-					model.bufferViews[normAccessor.bufferView];
-				bufferNormals = reinterpret_cast<const float *>(
-					&(model.buffers[normView.buffer]
-						  .data[normAccessor.byteOffset + normView.byteOffset]));
-				meshHasNorm = true;
-				cntNorm = normAccessor.count;
-				if(cntNorm > cntTot) cntTot = cntNorm;
-			} else {
-				if(VD->Normal.hasIt) {
-					std::cout << "Warning: vertex layout has normal, but file "
-								 "hasn't\n";
-				}
-			}
-
-			auto tIt = primitive.attributes.find("TANGENT");
-			if(tIt != primitive.attributes.end()) {
-				const tinygltf::Accessor &tanAccessor = model.accessors[tIt->second];
-				const tinygltf::BufferView &tanView =
-					model.bufferViews[tanAccessor.bufferView];
-				bufferTangents = reinterpret_cast<const float *>(
-					&(model.buffers[tanView.buffer]
-						  .data[tanAccessor.byteOffset + tanView.byteOffset]));
-				meshHasTan = true;
-				cntTan = tanAccessor.count;
-				if(cntTan > cntTot) cntTot = cntTan;
-			} else {
-				if(VD->Tangent.hasIt) {
-					std::cout << "Warning: vertex layout has tangent, but file "
-								 "hasn't\n";
-				}
-			}
-
-			auto uIt = primitive.attributes.find("TEXCOORD_0");
-			if(uIt != primitive.attributes.end()) {
-				const tinygltf::Accessor &uvAccessor = model.accessors[uIt->second];
-				const tinygltf::BufferView &uvView =
-					model.bufferViews[uvAccessor.bufferView];
-				bufferTexCoords = reinterpret_cast<const float *>(
-					&(model.buffers[uvView.buffer]
-						  .data[uvAccessor.byteOffset + uvView.byteOffset]));
-				meshHasUV = true;
-				cntUV = uvAccessor.count;
-				if(cntUV > cntTot) cntTot = cntUV;
-			} else {
-				if(VD->UV.hasIt) {
-					std::cout
-						<< "Warning: vertex layout has UV, but file hasn't\n";
-				}
-			}
-
-			std::vector<glm::vec3> itemVertices;
-			for(int i = 0; i < cntTot; i++) {
-				Vert vertex{};
-
-				if((i < cntPos) && meshHasPos && VD->Position.hasIt) {
-					glm::vec3 pos = {bufferPos[3 * i + 0], bufferPos[3 * i + 1],
-									 bufferPos[3 * i + 2]};
-					glm::vec3 *o =
-						(glm::vec3 *)((char *)(&vertex) + VD->Position.offset);
-					*o = pos;
-					itemVertices.push_back(pos);
-				}
-
-				if((i < cntNorm) && meshHasNorm && VD->Normal.hasIt) {
-					glm::vec3 normal = {bufferNormals[3 * i + 0],
-										bufferNormals[3 * i + 1],
-										bufferNormals[3 * i + 2]};
-					glm::vec3 *o =
-						(glm::vec3 *)((char *)(&vertex) + VD->Normal.offset);
-					*o = normal;
-				}
-
-				if((i < cntTan) && meshHasTan && VD->Tangent.hasIt) {
-					glm::vec4 tangent = {bufferTangents[4 * i + 0],
-										 bufferTangents[4 * i + 1],
-										 bufferTangents[4 * i + 2],
-										 bufferTangents[4 * i + 3]};
-					glm::vec4 *o =
-						(glm::vec4 *)((char *)(&vertex) + VD->Tangent.offset);
-					*o = tangent;
-				}
-
-				if((i < cntUV) && meshHasUV && VD->UV.hasIt) {
-					glm::vec2 texCoord = {bufferTexCoords[2 * i + 0],
-										  bufferTexCoords[2 * i + 1]};
-					glm::vec2 *o = (glm::vec2 *)((char *)(&vertex) + VD->UV.offset);
-					*o = texCoord;
-				}
-
-				vertices.push_back(vertex);
-			}
-			vecMap[id] = itemVertices;
-
-			const tinygltf::Accessor &accessor = model.accessors[primitive.indices];
-			const tinygltf::BufferView &bufferView =
-				model.bufferViews[accessor.bufferView];
-			const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
-
-			switch(accessor.componentType) {
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
-					const uint16_t *bufferIndex = reinterpret_cast<const uint16_t *>(
-						&(buffer.data[accessor.byteOffset + bufferView.byteOffset]));
-					for(int i = 0; i < accessor.count; i++) {
-						indices.push_back(bufferIndex[i]);
-					}
-				} break;
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
-					const uint32_t *bufferIndex = reinterpret_cast<const uint32_t *>(
-						&(buffer.data[accessor.byteOffset + bufferView.byteOffset]));
-					for(int i = 0; i < accessor.count; i++) {
-						indices.push_back(bufferIndex[i]);
-					}
-				} break;
-				default:
-					std::cerr << "Index component type " << accessor.componentType
-							  << " not supported!" << std::endl;
-					throw std::runtime_error("Error loading GLTF component");
-			}
-		}
-	}
-
-	std::cout << "\t" << (encoded ? "[MGCG]" : "[GLTF]")
-			  << " Vertices: " << vertices.size()
-			  << "\n\tIndices: " << indices.size() << "\n";
-}
-
 template<class Vert>
 void Model<Vert>::createVertexBuffer() {
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+	VkDeviceSize bufferSize = sizeof(this->vertices[0]) * this->vertices.size();
 
-	BP->createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-					 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-						 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					 vertexBuffer, vertexBufferMemory);
-
-	void *data;
-	vkMapMemory(BP->device, vertexBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, vertices.data(), (size_t)bufferSize);
-	vkUnmapMemory(BP->device, vertexBufferMemory);
+	BP->createGeometryBuffer(this->vertices.data(), bufferSize,
+							 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer,
+							 vertexBufferMemory);
 }
 
 template<class Vert>
 void Model<Vert>::createIndexBuffer() {
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-	BP->createBuffer(bufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-					 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-						 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					 indexBuffer, indexBufferMemory);
+	VkDeviceSize bufferSize = sizeof(this->indices[0]) * this->indices.size();
 
-	void *data;
-	vkMapMemory(BP->device, indexBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, indices.data(), (size_t)bufferSize);
-	vkUnmapMemory(BP->device, indexBufferMemory);
+	BP->createGeometryBuffer(this->indices.data(), bufferSize,
+							 VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer,
+							 indexBufferMemory);
 }
 
 template<class Vert>
 void Model<Vert>::initMesh(BaseProject *bp, VertexDescriptor *vd) {
 	BP = bp;
-	VD = vd;
-	std::cout << "[Manual] Vertices: " << vertices.size()
-			  << "\nIndices: " << indices.size() << "\n";
+	this->VD = vd;
+	std::cout << "[Manual] Vertices: " << this->vertices.size()
+			  << "\nIndices: " << this->indices.size() << "\n";
+	this->computeBounds();
+	this->buildCollisionMesh();
 	createVertexBuffer();
 	createIndexBuffer();
 }
 
 template<class Vert>
 void Model<Vert>::init(BaseProject *bp, VertexDescriptor *vd, std::string file,
-					   ModelType MT, std::string id,
-					   std::unordered_map<std::string, std::vector<glm::vec3>> &vecMap) {
+					   ModelType MT) {
 	BP = bp;
-	VD = vd;
-	if(MT == OBJ) {
-		loadModelOBJ(file, id, vecMap);
-	} else if(MT == GLTF) {
-		loadModelGLTF(file, false, id, vecMap);
-	} else if(MT == MGCG) {
-		loadModelGLTF(file, true, id, vecMap);
-	}
+	this->VD = vd;
+	this->load(file, MT);
+
+	createVertexBuffer();
+	createIndexBuffer();
+}
+
+template<class Vert>
+void Model<Vert>::initLoaded(BaseProject *bp) {
+	BP = bp;
+	this->wait();
 
 	createVertexBuffer();
 	createIndexBuffer();
@@ -2393,11 +3065,9 @@ void Model<Vert>::bind(VkCommandBuffer commandBuffer) {
 }
 
 
-void Texture::createTextureImage(const char *const files[],
-								 VkFormat Fmt = VK_FORMAT_R8G8B8A8_SRGB) {
-	int texWidth, texHeight, texChannels;
+void Texture::loadImages(const char *const files[]) {
+	int texChannels;
 	int curWidth = -1, curHeight = -1, curChannels = -1;
-	stbi_uc *pixels[maxImgs];
 
 	for(int i = 0; i < imgs; i++) {
 		pixels[i] = stbi_load(files[i], &texWidth, &texHeight, &texChannels,
@@ -2421,28 +3091,22 @@ void Texture::createTextureImage(const char *const files[],
 			}
 		}
 	}
+}
 
+void Texture::uploadImages(VkFormat Fmt) {
 	VkDeviceSize imageSize = texWidth * texHeight * 4;
 	VkDeviceSize totalImageSize = texWidth * texHeight * 4 * imgs;
 	mipLevels =
 		static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
+	BP->beginUploadBatch();
 	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	BP->createBuffer(totalImageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-					 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-						 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					 stagingBuffer, stagingBufferMemory);
-	void *data;
-	vkMapMemory(BP->device, stagingBufferMemory, 0, totalImageSize, 0, &data);
+	VkDeviceSize stagingOffset;
+	unsigned char *data = BP->stageUpload(totalImageSize, stagingBuffer, stagingOffset);
 	for(int i = 0; i < imgs; i++) {
-		memcpy(static_cast<char *>(data) + imageSize * i, pixels[i],
-			   static_cast<size_t>(imageSize));
+		memcpy(data + imageSize * i, pixels[i], static_cast<size_t>(imageSize));
 		stbi_image_free(pixels[i]);
 	}
-	vkUnmapMemory(BP->device, stagingBufferMemory);
-
 
 	BP->createImage(texWidth, texHeight, mipLevels, imgs, VK_SAMPLE_COUNT_1_BIT,
 					Fmt, VK_IMAGE_TILING_OPTIMAL,
@@ -2452,15 +3116,16 @@ void Texture::createTextureImage(const char *const files[],
 					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage,
 					textureImageMemory);
 
-	BP->transitionImageLayout(textureImage, Fmt, VK_IMAGE_LAYOUT_UNDEFINED,
-							  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels, imgs);
-	BP->copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth),
-						  static_cast<uint32_t>(texHeight), imgs);
-
-	BP->generateMipmaps(textureImage, Fmt, texWidth, texHeight, mipLevels, imgs);
+	BP->recordImageUpload(stagingBuffer, stagingOffset, textureImage, Fmt,
+						  static_cast<uint32_t>(texWidth),
+						  static_cast<uint32_t>(texHeight), mipLevels, imgs);
+	BP->endUploadBatch();
+}
 
-	vkDestroyBuffer(BP->device, stagingBuffer, nullptr);
-	vkFreeMemory(BP->device, stagingBufferMemory, nullptr);
+void Texture::createTextureImage(const char *const files[],
+								 VkFormat Fmt = VK_FORMAT_R8G8B8A8_SRGB) {
+	loadImages(files);
+	uploadImages(Fmt);
 }
 
 void Texture::createTextureImageView(VkFormat Fmt = VK_FORMAT_R8G8B8A8_SRGB) {
@@ -2503,13 +3168,305 @@ void Texture::createTextureSampler(
 }
 
 
+void Texture::prepareLevels(const char *file, VkFormat Fmt) {
+	requestedFormat = Fmt;
+	if(loadCache(file, Fmt)) {
+		return;
+	}
+
+	const char *files[1] = {file};
+	loadImages(files);
+	buildLevels(Fmt);
+	storeCache(file);
+}
+
+
+bool Texture::loadCache(const std::string &file, VkFormat Fmt) {
+	std::error_code ec;
+	auto sourceTime = std::filesystem::last_write_time(file, ec);
+	if(ec) return false;
+	auto sourceSize = std::filesystem::file_size(file, ec);
+	if(ec) return false;
+
+	if(!cacheFile.open(textureCachePath(file, Fmt))) return false;
+
+	TextureCacheHeader header;
+	if(cacheFile.size < sizeof(header)) return false;
+	memcpy(&header, cacheFile.data, sizeof(header));
+
+	if(memcmp(header.magic, "TXCC", 4) != 0 ||
+	   header.version != TEXTURE_CACHE_VERSION ||
+	   header.sourceTime != (uint64_t)sourceTime.time_since_epoch().count() ||
+	   header.sourceSize != sourceSize || header.requestedFormat != (uint32_t)Fmt ||
+	   header.compressed != (uint32_t)textureCacheCompression ||
+	   header.layers != (uint32_t)imgs || header.mipLevels == 0 ||
+	   header.mipLevels > 32 || header.pathLength != file.size()) {
+		cacheFile.close();
+		return false;
+	}
+
+	size_t tableEnd = sizeof(header) + header.pathLength +
+					  header.mipLevels * sizeof(TextureCacheLevel);
+	if(cacheFile.size < tableEnd ||
+	   file.compare(0, file.size(), cacheFile.data + sizeof(header),
+					header.pathLength) != 0) {
+		cacheFile.close();
+		return false;
+	}
+
+	std::vector<TextureCacheLevel> levels(header.mipLevels);
+	memcpy(levels.data(), cacheFile.data + sizeof(header) + header.pathLength,
+		   levels.size() * sizeof(TextureCacheLevel));
+	VkFormat format = (VkFormat)header.format;
+	for(uint32_t i = 0; i < header.mipLevels; i++) {
+		size_t expected = imageLevelSize(format, std::max(header.width >> i, 1u),
+										 std::max(header.height >> i, 1u)) *
+						  header.layers;
+		if(levels[i].size != expected ||
+		   tableEnd + levels[i].offset + levels[i].size > cacheFile.size) {
+			cacheFile.close();
+			return false;
+		}
+	}
+
+	std::cout << "Loading : " << file << "[CACHE]\n";
+	texWidth = header.width;
+	texHeight = header.height;
+	mipLevels = header.mipLevels;
+	texelFormat = format;
+	texels = reinterpret_cast<const unsigned char *>(cacheFile.data) + tableEnd;
+	levelOffsets.resize(mipLevels);
+	for(uint32_t i = 0; i < mipLevels; i++) levelOffsets[i] = levels[i].offset;
+	return true;
+}
+
+
+void Texture::buildLevels(VkFormat Fmt) {
+	mipLevels =
+		static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+	bool srgb = (Fmt == VK_FORMAT_R8G8B8A8_SRGB);
+	int channels = textureChannels(Fmt);
+
+	bool alpha = false;
+	for(int l = 0; l < imgs && channels == 4 && !alpha; l++) {
+		for(size_t i = 3; i < (size_t)texWidth * texHeight * 4; i += 4) {
+			if(pixels[l][i] != 255) {
+				alpha = true;
+				break;
+			}
+		}
+	}
+
+	texelFormat = Fmt;
+	if(textureCacheCompression && Fmt == VK_FORMAT_R8G8B8A8_SRGB) {
+		texelFormat = alpha ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+	} else if(textureCacheCompression && Fmt == VK_FORMAT_R8G8B8A8_UNORM) {
+		texelFormat = alpha ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	} else if(textureCacheCompression && Fmt == VK_FORMAT_R8_UNORM) {
+		texelFormat = VK_FORMAT_BC4_UNORM_BLOCK;
+	} else if(textureCacheCompression && Fmt == VK_FORMAT_R8G8_UNORM) {
+		texelFormat = VK_FORMAT_BC5_UNORM_BLOCK;
+	}
+
+	// 16-byte aligned levels satisfy every bufferOffset requirement
+	levelOffsets.resize(mipLevels);
+	VkDeviceSize total = 0;
+	for(uint32_t i = 0; i < mipLevels; i++) {
+		levelOffsets[i] = total;
+		total += imageLevelSize(texelFormat, std::max((uint32_t)texWidth >> i, 1u),
+								std::max((uint32_t)texHeight >> i, 1u)) * imgs;
+		total = (total + 15) / 16 * 16;
+	}
+	builtTexels.assign(total, 0);
+
+	std::vector<unsigned char> level, next;
+	for(int l = 0; l < imgs; l++) {
+		uint32_t w = texWidth, h = texHeight;
+		// keep the leading channels the format stores
+		level.resize((size_t)w * h * channels);
+		for(size_t i = 0; i < (size_t)w * h; i++) {
+			memcpy(&level[i * channels], pixels[l] + i * 4, channels);
+		}
+		stbi_image_free(pixels[l]);
+
+		for(uint32_t i = 0; i < mipLevels; i++) {
+			unsigned char *dst = builtTexels.data() + levelOffsets[i] +
+								 imageLevelSize(texelFormat, w, h) * l;
+			if(isBlockCompressed(texelFormat)) {
+				encodeBCLevel(level.data(), w, h, texelFormat, dst);
+			} else {
+				memcpy(dst, level.data(), level.size());
+			}
+
+			if(i + 1 < mipLevels) {
+				next.resize((size_t)std::max(w / 2, 1u) * std::max(h / 2, 1u) * channels);
+				downsampleLevel(level.data(), w, h, channels, srgb, next.data());
+				level.swap(next);
+				w = std::max(w / 2, 1u);
+				h = std::max(h / 2, 1u);
+			}
+		}
+	}
+	texels = builtTexels.data();
+}
+
+
+void Texture::storeCache(const std::string &file) {
+	std::error_code ec;
+	auto sourceTime = std::filesystem::last_write_time(file, ec);
+	if(ec) return;
+	auto sourceSize = std::filesystem::file_size(file, ec);
+	if(ec) return;
+
+	std::filesystem::create_directories(ASSET_CACHE_DIR, ec);
+	if(ec) {
+		std::cout << "Warning: cannot create " << ASSET_CACHE_DIR << "\n";
+		return;
+	}
+
+	TextureCacheHeader header{};
+	memcpy(header.magic, "TXCC", 4);
+	header.version = TEXTURE_CACHE_VERSION;
+	header.sourceTime = (uint64_t)sourceTime.time_since_epoch().count();
+	header.sourceSize = sourceSize;
+	header.requestedFormat = requestedFormat;
+	header.format = texelFormat;
+	header.compressed = textureCacheCompression;
+	header.width = texWidth;
+	header.height = texHeight;
+	header.layers = imgs;
+	header.mipLevels = mipLevels;
+	header.pathLength = file.size();
+
+	std::vector<TextureCacheLevel> levels(mipLevels);
+	for(uint32_t i = 0; i < mipLevels; i++) {
+		levels[i].offset = levelOffsets[i];
+		levels[i].size = imageLevelSize(texelFormat, std::max((uint32_t)texWidth >> i, 1u),
+										std::max((uint32_t)texHeight >> i, 1u)) * imgs;
+	}
+
+	// Write aside and rename, so that a concurrent run never maps half a file
+	std::string cacheName = textureCachePath(file, requestedFormat);
+	std::string tmpFile =
+		cacheName + "." +
+		std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+		".tmp";
+	std::ofstream out(tmpFile, std::ios::binary | std::ios::trunc);
+	if(!out.is_open()) {
+		std::cout << "Warning: cannot write " << tmpFile << "\n";
+		return;
+	}
+
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	out.write(file.data(), file.size());
+	out.write(reinterpret_cast<const char *>(levels.data()),
+			  levels.size() * sizeof(TextureCacheLevel));
+	out.write(reinterpret_cast<const char *>(builtTexels.data()), builtTexels.size());
+	out.close();
+
+	if(!out) {
+		std::cout << "Warning: cannot write " << tmpFile << "\n";
+		std::filesystem::remove(tmpFile, ec);
+		return;
+	}
+
+	std::filesystem::rename(tmpFile, cacheName, ec);
+	if(ec) std::filesystem::remove(tmpFile, ec);
+}
+
+
+void Texture::uploadLevels() {
+	std::vector<VkDeviceSize> sizes(mipLevels);
+	for(uint32_t i = 0; i < mipLevels; i++) {
+		sizes[i] = imageLevelSize(texelFormat, std::max((uint32_t)texWidth >> i, 1u),
+								  std::max((uint32_t)texHeight >> i, 1u)) * imgs;
+	}
+
+	if(isBlockCompressed(texelFormat) && !BP->textureCompressionBC) {
+		// no BC sampling on this device: expand the blocks back
+		std::vector<VkDeviceSize> offsets(mipLevels);
+		VkDeviceSize total = 0;
+		for(uint32_t i = 0; i < mipLevels; i++) {
+			offsets[i] = total;
+			sizes[i] = imageLevelSize(requestedFormat, std::max((uint32_t)texWidth >> i, 1u),
+									  std::max((uint32_t)texHeight >> i, 1u)) * imgs;
+			total = (total + sizes[i] + 15) / 16 * 16;
+		}
+		std::vector<unsigned char> decoded(total);
+		for(uint32_t i = 0; i < mipLevels; i++) {
+			uint32_t w = std::max((uint32_t)texWidth >> i, 1u);
+			uint32_t h = std::max((uint32_t)texHeight >> i, 1u);
+			for(int l = 0; l < imgs; l++) {
+				decodeBCLevel(texels + levelOffsets[i] + imageLevelSize(texelFormat, w, h) * l,
+							  w, h, texelFormat,
+							  decoded.data() + offsets[i] + imageLevelSize(requestedFormat, w, h) * l);
+			}
+		}
+		builtTexels.swap(decoded);
+		texels = builtTexels.data();
+		levelOffsets = offsets;
+		texelFormat = requestedFormat;
+	}
+
+	VkDeviceSize totalSize = levelOffsets[mipLevels - 1] + sizes[mipLevels - 1];
+
+	BP->beginUploadBatch();
+	VkBuffer stagingBuffer;
+	VkDeviceSize stagingOffset;
+	unsigned char *data = BP->stageUpload(totalSize, stagingBuffer, stagingOffset);
+	memcpy(data, texels, (size_t)totalSize);
+
+	BP->createImage(texWidth, texHeight, mipLevels, imgs, VK_SAMPLE_COUNT_1_BIT,
+					texelFormat, VK_IMAGE_TILING_OPTIMAL,
+					VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+					imgs == 6 ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0,
+					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage,
+					textureImageMemory);
+	BP->recordImageUpload(stagingBuffer, stagingOffset, textureImage, texelFormat,
+						  static_cast<uint32_t>(texWidth),
+						  static_cast<uint32_t>(texHeight), mipLevels, imgs,
+						  levelOffsets.data());
+	BP->endUploadBatch();
+
+	texels = nullptr;
+	builtTexels.clear();
+	builtTexels.shrink_to_fit();
+	cacheFile.close();
+}
+
+
 void Texture::init(BaseProject *bp, const char *file,
 				   VkFormat Fmt = VK_FORMAT_R8G8B8A8_SRGB, bool initSampler = true) {
-	const char *files[1] = {file};
 	BP = bp;
 	imgs = 1;
-	createTextureImage(files, Fmt);
-	createTextureImageView(Fmt);
+	prepareLevels(file, Fmt);
+	uploadLevels();
+	createTextureImageView(texelFormat);
+	if(initSampler) {
+		createTextureSampler();
+	}
+}
+
+
+void Texture::loadAsync(const char *file, VkFormat Fmt = VK_FORMAT_R8G8B8A8_SRGB) {
+	std::string path = file;
+	imgs = 1;
+	loading = loaderPool().submit(
+		[this, path, Fmt]() { prepareLevels(path.c_str(), Fmt); });
+}
+
+
+void Texture::loadAsync(const char *file, TextureSemantic sem) {
+	semantic = sem;
+	loadAsync(file, textureSemanticFormat(sem));
+}
+
+
+void Texture::initLoaded(BaseProject *bp, bool initSampler = true) {
+	BP = bp;
+	loading.get();
+	uploadLevels();
+	createTextureImageView(texelFormat);
 	if(initSampler) {
 		createTextureSampler();
 	}
@@ -2538,6 +3495,8 @@ void Pipeline::init(BaseProject *bp, VertexDescriptor *vd,
 					std::vector<DescriptorSetLayout *> d) {
 	BP = bp;
 	VD = vd;
+	this->VertShader = VertShader;
+	this->FragShader = FragShader;
 
 	std::cout << "\n== Initializing pipeline ==\n";
 	auto vertShaderCode = readFile(VertShader);
@@ -2556,6 +3515,9 @@ void Pipeline::init(BaseProject *bp, VertexDescriptor *vd,
 	transp = false;
 
 	D = d;
+
+	BP->watchShader(this, VertShader);
+	BP->watchShader(this, FragShader);
 }
 
 void Pipeline::setAdvancedFeatures(VkCompareOp _compareOp, VkPolygonMode _polyModel,
@@ -2723,7 +3685,59 @@ void Pipeline::create() {
 	}
 }
 
+/**
+ * Create the pipeline again from the current content of its shader
+ * files. On errors, such as a shader caught halfway through being
+ * written, the running pipeline is kept
+ */
+bool Pipeline::reload() {
+	VkShaderModule oldVert = vertShaderModule;
+	VkShaderModule oldFrag = fragShaderModule;
+	VkPipelineLayout oldLayout = pipelineLayout;
+	VkPipeline oldPipeline = graphicsPipeline;
+
+	vertShaderModule = VK_NULL_HANDLE;
+	fragShaderModule = VK_NULL_HANDLE;
+	try {
+		auto vertShaderCode = readFile(VertShader);
+		auto fragShaderCode = readFile(FragShader);
+		for(auto *code : {&vertShaderCode, &fragShaderCode}) {
+			if(code->size() < 4 || code->size() % 4 != 0 ||
+			   *reinterpret_cast<const uint32_t *>(code->data()) != 0x07230203) {
+				throw std::runtime_error("not a SPIR-V module");
+			}
+		}
+
+		vertShaderModule = createShaderModule(vertShaderCode);
+		fragShaderModule = createShaderModule(fragShaderCode);
+		create();
+	} catch(const std::runtime_error &e) {
+		std::cout << "Pipeline <" << VertShader << ", " << FragShader
+				  << "> not rebuilt: " << e.what() << "\n";
+		if(pipelineLayout != oldLayout) {
+			vkDestroyPipelineLayout(BP->device, pipelineLayout, nullptr);
+		}
+		vkDestroyShaderModule(BP->device, fragShaderModule, nullptr);
+		vkDestroyShaderModule(BP->device, vertShaderModule, nullptr);
+		vertShaderModule = oldVert;
+		fragShaderModule = oldFrag;
+		pipelineLayout = oldLayout;
+		graphicsPipeline = oldPipeline;
+		return false;
+	}
+
+	VkDevice device = BP->device;
+	BP->retire([device, oldVert, oldFrag, oldLayout, oldPipeline]() {
+		vkDestroyPipeline(device, oldPipeline, nullptr);
+		vkDestroyPipelineLayout(device, oldLayout, nullptr);
+		vkDestroyShaderModule(device, oldFrag, nullptr);
+		vkDestroyShaderModule(device, oldVert, nullptr);
+	});
+	return true;
+}
+
 void Pipeline::destroy() {
+	BP->unwatchShaders(this);
 	vkDestroyShaderModule(BP->device, fragShaderModule, nullptr);
 	vkDestroyShaderModule(BP->device, vertShaderModule, nullptr);
 }
@@ -2814,20 +3828,7 @@ void DescriptorSet::init(BaseProject *bp, DescriptorSetLayout *DSL,
 
 	std::vector<VkDescriptorSetLayout> layouts(BP->swapChainImages.size(),
 											   DSL->descriptorSetLayout);
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = BP->descriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(BP->swapChainImages.size());
-	allocInfo.pSetLayouts = layouts.data();
-
-	descriptorSets.resize(BP->swapChainImages.size());
-
-	VkResult result =
-		vkAllocateDescriptorSets(BP->device, &allocInfo, descriptorSets.data());
-	if(result != VK_SUCCESS) {
-		PrintVkError(result);
-		throw std::runtime_error("failed to allocate descriptor sets!");
-	}
+	pool = BP->allocateDescriptorSets(layouts, descriptorSets);
 
 	for(size_t i = 0; i < BP->swapChainImages.size(); i++) {
 		std::vector<VkWriteDescriptorSet> descriptorWrites(E.size());
@@ -2847,6 +3848,11 @@ void DescriptorSet::init(BaseProject *bp, DescriptorSetLayout *DSL,
 				descriptorWrites[j].descriptorCount = 1;
 				descriptorWrites[j].pBufferInfo = &bufferInfo[j];
 			} else if(E[j].type == TEXTURE) {
+				if(i == 0 && E[j].tex->requestedFormat !=
+								 textureSemanticFormat(E[j].semantic)) {
+					std::cout << "WARNING: binding " << E[j].binding
+							  << " samples a texture loaded with a different semantic\n";
+				}
 				imageInfo[j].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 				imageInfo[j].imageView = E[j].tex->textureImageView;
 				imageInfo[j].sampler = E[j].tex->textureSampler;
@@ -2876,6 +3882,12 @@ void DescriptorSet::cleanup() {
 			}
 		}
 	}
+	if(pool != VK_NULL_HANDLE) {
+		vkFreeDescriptorSets(BP->device, pool,
+							 static_cast<uint32_t>(descriptorSets.size()),
+							 descriptorSets.data());
+		pool = VK_NULL_HANDLE;
+	}
 }
 
 void DescriptorSet::bind(VkCommandBuffer commandBuffer, Pipeline &P, int setId,
@@ -0,0 +1,268 @@
+// Checks AesCbcDecryptor against plusaes::decrypt_cbc on every backend
+// this CPU supports: the bundled models, and random buffers of every
+// length around the eight blocks decrypted at once, with and without
+// padding. With --bench, reports the throughput of each backend instead
+
+#include "../modules/Assets.hpp"
+
+#include <chrono>
+#include <random>
+
+typedef std::vector<unsigned char> Bytes;
+
+const AesCbcDecryptor::Backend BACKENDS[] = {AesCbcDecryptor::PORTABLE,
+											 AesCbcDecryptor::AESNI,
+											 AesCbcDecryptor::ARMV8};
+
+int failures = 0;
+
+void expect(bool ok, const std::string &what) {
+	if(!ok) {
+		std::cout << "FAILED: " << what << "\n";
+		failures++;
+	}
+}
+
+/**
+ * Decrypt data with a backend, chunk bytes at a time as decodeMGCG() does
+ * @param chunk a multiple of 16, or 0 for a single call
+ * @param inPlace decrypt over a copy of data instead of to another buffer
+ */
+Bytes decrypt(AesCbcDecryptor::Backend backend, const Bytes &key, const unsigned char iv0[16],
+			  const Bytes &data, size_t chunk, bool inPlace) {
+	AesCbcDecryptor aes(key, backend);
+	Bytes out(data.size());
+	if(inPlace) out = data;
+	const unsigned char *in = inPlace ? out.data() : data.data();
+	if(chunk == 0) chunk = data.size();
+
+	unsigned char iv[16];
+	memcpy(iv, iv0, sizeof(iv));
+	for(size_t done = 0; done < data.size(); done += chunk) {
+		size_t len = std::min(chunk, data.size() - done);
+		aes.decrypt(in + done, out.data() + done, len, iv);
+	}
+	return out;
+}
+
+/**
+ * plusaes::decrypt_cbc() of data, the padding being removed if unpad
+ * @return empty if plusaes rejects the padding
+ */
+Bytes reference(const Bytes &key, const unsigned char iv[16], const Bytes &data, bool unpad) {
+	Bytes out(data.size());
+	unsigned long padded = 0;
+	plusaes::Error e = plusaes::decrypt_cbc(
+		data.data(), data.size(), key.data(), key.size(),
+		reinterpret_cast<const unsigned char(*)[16]>(iv), out.data(), out.size(),
+		unpad ? &padded : nullptr);
+	if(e != plusaes::kErrorOk) return Bytes();
+	out.resize(data.size() - padded);
+	return out;
+}
+
+/// PKCS#7 padding removed as decodeMGCG() does, empty if it is invalid
+Bytes unpad(Bytes plain) {
+	size_t padded = plain.empty() ? 0 : plain.back();
+	if(padded == 0 || padded > 16) return Bytes();
+	for(size_t i = 0; i < padded; i++) {
+		if(plain[plain.size() - 1 - i] != padded) return Bytes();
+	}
+	plain.resize(plain.size() - padded);
+	return plain;
+}
+
+Bytes randomBytes(std::mt19937 &rng, size_t size) {
+	Bytes b(size);
+	for(unsigned char &c : b) c = (unsigned char)rng();
+	return b;
+}
+
+/**
+ * Every backend against plusaes on random data: whole blocks of every
+ * count from 1 to 40, plain texts padded to every length from 0 to 100,
+ * and the three key sizes
+ */
+void checkRandom(AesCbcDecryptor::Backend backend) {
+	std::string name = AesCbcDecryptor::backendName(backend);
+	std::mt19937 rng(2023);
+	for(size_t keySize : {16, 24, 32}) {
+		for(size_t blocks = 1; blocks <= 40; blocks++) {
+			Bytes key = randomBytes(rng, keySize);
+			Bytes iv = randomBytes(rng, 16);
+			Bytes data = randomBytes(rng, blocks * 16);
+			Bytes expected = reference(key, iv.data(), data, false);
+			std::string what = name + ", key " + std::to_string(keySize * 8) + ", " +
+							   std::to_string(blocks) + " blocks";
+
+			expect(decrypt(backend, key, iv.data(), data, 0, false) == expected, what);
+			expect(decrypt(backend, key, iv.data(), data, 0, true) == expected,
+				   what + " in place");
+			expect(decrypt(backend, key, iv.data(), data, 3 * 16, false) == expected,
+				   what + " in chunks of 3 blocks");
+		}
+
+		for(size_t size = 0; size <= 100; size++) {
+			Bytes key = randomBytes(rng, keySize);
+			Bytes iv = randomBytes(rng, 16);
+			Bytes plain = randomBytes(rng, size);
+			Bytes cipher(plusaes::get_padded_encrypted_size(size));
+			plusaes::encrypt_cbc(plain.data(), plain.size(), key.data(), key.size(),
+								 reinterpret_cast<const unsigned char(*)[16]>(iv.data()),
+								 cipher.data(), cipher.size(), true);
+			Bytes expected = reference(key, iv.data(), cipher, true);
+			std::string what = name + ", key " + std::to_string(keySize * 8) + ", " +
+							   std::to_string(size) + " bytes padded";
+
+			expect(expected == plain, what + " (plusaes)");
+			expect(unpad(decrypt(backend, key, iv.data(), cipher, 0, false)) == expected,
+				   what);
+		}
+	}
+}
+
+/**
+ * Every backend against plusaes on the bundled models, decrypted in the
+ * chunks of decodeMGCG()
+ * @return the number of files checked
+ */
+int checkModels(AesCbcDecryptor::Backend backend) {
+	Bytes key = plusaes::key_from_string(&"CG2023SkelKey128");
+	const unsigned char iv[16] = {
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+		0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+	};
+
+	int files = 0;
+	for(auto &entry : std::filesystem::directory_iterator("models")) {
+		if(entry.path().extension() != ".mgcg") continue;
+		std::string file = entry.path().string();
+		std::vector<char> raw = readFile(file);
+		Bytes data(raw.begin(), raw.end());
+
+		Bytes expected = reference(key, iv, data, true);
+		expect(!expected.empty(), file + " (plusaes)");
+		Bytes plain = unpad(decrypt(backend, key, iv, data, MGCG_CHUNK_SIZE, false));
+		expect(plain == expected, std::string(AesCbcDecryptor::backendName(backend)) +
+									  ", " + file);
+		files++;
+	}
+	return files;
+}
+
+/**
+ * decodeMGCG() of files whose PKCS#7 padding is invalid: a pad length
+ * of 0, one over 16, and pad bytes not all holding the length
+ */
+void checkBadPadding() {
+	Bytes key = plusaes::key_from_string(&"CG2023SkelKey128");
+	const unsigned char iv[16] = {
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+		0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+	};
+	std::string file =
+		(std::filesystem::temp_directory_path() / "aes_cbc_padding.mgcg").string();
+
+	const std::vector<Bytes> tails = {{0}, {17}, {3, 2}, {1, 16}};
+	for(auto &tail : tails) {
+		Bytes plain(32, 0);
+		memcpy(plain.data(), "16", 2);
+		std::copy(tail.begin(), tail.end(), plain.end() - tail.size());
+		Bytes cipher(plain.size());
+		plusaes::encrypt_cbc(plain.data(), plain.size(), key.data(), key.size(),
+							 reinterpret_cast<const unsigned char(*)[16]>(iv),
+							 cipher.data(), cipher.size(), false);
+		std::ofstream(file, std::ios::binary)
+			.write(reinterpret_cast<const char *>(cipher.data()), cipher.size());
+
+		bool rejected = false;
+		try {
+			size_t size;
+			decodeMGCG(file, size);
+		} catch(const std::runtime_error &e) {
+			rejected = std::string(e.what()).find("failed to decrypt") == 0;
+		}
+		expect(rejected, "padding ending in " + std::to_string(tail.back()) + " rejected");
+	}
+	std::filesystem::remove(file);
+}
+
+/**
+ * Throughput of every backend and of plusaes::decrypt_cbc, on a buffer
+ * of megabytes decrypted in the chunks of decodeMGCG()
+ */
+void bench(size_t megabytes) {
+	std::mt19937 rng(2023);
+	Bytes key = randomBytes(rng, 16);
+	Bytes iv = randomBytes(rng, 16);
+	Bytes data = randomBytes(rng, megabytes << 20);
+	Bytes out(data.size());
+
+	auto report = [&](const std::string &name, const std::function<void()> &run) {
+		run();
+		int runs = 0;
+		auto start = std::chrono::steady_clock::now();
+		float elapsed = 0.0f;
+		do {
+			run();
+			runs++;
+			elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() -
+												   start).count();
+		} while(elapsed < 0.5f);
+		std::cout << name << ": " << megabytes * runs / elapsed << " MB/s\n";
+	};
+
+	for(AesCbcDecryptor::Backend backend : BACKENDS) {
+		if(!AesCbcDecryptor::supported(backend)) continue;
+		AesCbcDecryptor aes(key, backend);
+		report(AesCbcDecryptor::backendName(backend), [&]() {
+			unsigned char chain[16];
+			memcpy(chain, iv.data(), sizeof(chain));
+			for(size_t done = 0; done < data.size(); done += MGCG_CHUNK_SIZE) {
+				size_t len = std::min(MGCG_CHUNK_SIZE, data.size() - done);
+				aes.decrypt(data.data() + done, out.data() + done, len, chain);
+			}
+		});
+	}
+	report("plusaes::decrypt_cbc", [&]() {
+		plusaes::decrypt_cbc(data.data(), data.size(), key.data(), key.size(),
+							 reinterpret_cast<const unsigned char(*)[16]>(iv.data()),
+							 out.data(), out.size(), nullptr);
+	});
+}
+
+int main(int argc, char **argv) {
+	if(argc > 1 && std::string(argv[1]) == "--bench") {
+		bench(argc > 2 ? std::atol(argv[2]) : 64);
+		return EXIT_SUCCESS;
+	}
+	if(argc > 1) {
+		std::cout << "Usage: CG-AesCbcTest [--bench [MB]]\n";
+		return EXIT_FAILURE;
+	}
+
+	try {
+		for(AesCbcDecryptor::Backend backend : BACKENDS) {
+			std::string name = AesCbcDecryptor::backendName(backend);
+			if(!AesCbcDecryptor::supported(backend)) {
+				std::cout << name << ": not supported by this CPU, skipped\n";
+				continue;
+			}
+			checkRandom(backend);
+			int files = checkModels(backend);
+			expect(files > 0, "no .mgcg model found, run from the project root");
+			std::cout << name << ": checked, " << files << " models\n";
+		}
+		checkBadPadding();
+	} catch(const std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if(failures > 0) {
+		std::cout << failures << " checks failed\n";
+		return EXIT_FAILURE;
+	}
+	std::cout << "All checks passed\n";
+	return EXIT_SUCCESS;
+}